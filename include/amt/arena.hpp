@@ -0,0 +1,109 @@
+#ifndef INCLUDED_AMT_ARENA
+#define INCLUDED_AMT_ARENA
+
+#include <cstdint>
+#include <ostream>
+#include <vector>
+#include "amt/mapped_file.hpp"
+
+namespace amt {
+
+/**
+ * The memory that an AMT's nodes are allocated from. Words are allocated from fixed-size segments
+ * that are added as the arena grows, so growing never copies the nodes that were already
+ * allocated. A reference is a 64 bit word index whose high bits select the segment and whose low
+ * bits are the offset in the segment. An allocation never spans segments, so the words of a node
+ * can be addressed as its reference plus an offset. New words are zero.
+ *
+ * An arena is saved as its segments back to back, so a reference is also the offset of its word in
+ * the saved words, and a loaded arena's segments point into the mapped file instead of being
+ * copied. Allocations after loading go to new segments.
+ **/
+class Arena
+{
+
+private:
+
+    // a node is at most 1 (bitMap) + 64 (child pointers or leaf values) + 1 (partial sum) words
+    static const int MAX_ALLOCATION = 66;
+    // 2MiB segments so each one can be backed by a huge page
+    static const int DEFAULT_SEGMENT_BITS = 18;
+    // a saved arena starts with its segmentBits, numAllocated and freeIdx
+    static const int HEADER_SIZE = 3;
+
+    int segmentBits;
+    uint64_t segmentSize;
+    uint64_t segmentMask;
+    bool hugePages;
+
+    std::vector<uint64_t*> segments;
+    // the next word to allocate in the last segment
+    uint64_t freeIdx;
+    uint64_t numAllocated;
+    // the leading segments that are in a mapped file rather than allocated, and where the file's
+    // words end
+    uint64_t numMapped;
+    uint64_t mappedEnd;
+
+    void addSegment();
+
+public:
+
+    /**
+      * @param size The number of words to reserve segments for up front.
+      * @param hugePages Whether to back the segments with huge pages when the system allows it.
+      * @param segmentBits The log2 of the number of words in a segment.
+      */
+    Arena(uint64_t size = 0, bool hugePages = false, int segmentBits = DEFAULT_SEGMENT_BITS);
+
+    /**
+      * Loads a saved arena without copying its words.
+      *
+      * @param file The mapped file the arena was saved to; it must outlive the arena.
+      * @param offset The offset of the arena's words in the file.
+      * @param hugePages Whether to back segments added after loading with huge pages.
+      * @throws Exception if the file doesn't hold a saved arena at the offset.
+      */
+    Arena(const MappedFile& file, uint64_t offset, bool hugePages = false);
+    ~Arena();
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    uint64_t& operator[](uint64_t ref)
+    {
+        return segments[ref >> segmentBits][ref & segmentMask];
+    }
+
+    const uint64_t& operator[](uint64_t ref) const
+    {
+        return segments[ref >> segmentBits][ref & segmentMask];
+    }
+
+    /**
+      * Allocates contiguous words.
+      *
+      * @param size The number of words; at most MAX_ALLOCATION.
+      * @return The reference to the first word.
+      * @throws Exception if a segment can't be allocated.
+      */
+    uint64_t allocate(int size);
+
+    /** @return The number of words that have been allocated. */
+    uint64_t size() const { return numAllocated; }
+
+    /** @return The number of bytes of segments that have been reserved. */
+    uint64_t memSize() const { return segments.size() * segmentSize * sizeof(uint64_t); }
+
+    /**
+      * Writes the arena's header and the words of its segments up to the last allocation.
+      *
+      * @param out The binary stream to write to.
+      * @throws Exception if the stream can't be written.
+      */
+    void save(std::ostream& out) const;
+};
+
+}
+
+#endif
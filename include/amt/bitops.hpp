@@ -1,8 +1,13 @@
 #ifndef INCLUDED_AMT_BITOPS
 #define INCLUDED_AMT_BITOPS
 
+#include <bit>
 #include <cstdint>
 
+#if defined(__AVX512VPOPCNTDQ__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
 namespace amt {
 
 /**
@@ -21,6 +26,64 @@ uint64_t lowestOneBit(uint64_t value);
  */
 uint64_t highestOneBit(uint64_t value);
 
+/**
+ * Sums the popcounts of an array of 64 bit uints. Eight words are counted at a time with AVX-512
+ * VPOPCNTDQ or four at a time with AVX2 nibble lookups when the compiler targets them.
+ *
+ * @param words The uints.
+ * @param n The number of uints.
+ * @return The number of bits set.
+ */
+inline uint64_t popcountSum(const uint64_t* words, int n)
+{
+    int i = 0;
+    uint64_t sum = 0;
+#if defined(__AVX512VPOPCNTDQ__)
+    __m512i counts = _mm512_setzero_si512();
+    for (; i + 8 <= n; i += 8) {
+        counts = _mm512_add_epi64(counts, _mm512_popcnt_epi64(_mm512_loadu_si512(words + i)));
+    }
+    // the remaining words are loaded under a mask instead of counted one at a time
+    if (i < n) {
+        __mmask8 mask = (__mmask8) ((1 << (n - i)) - 1);
+        counts = _mm512_add_epi64(counts, _mm512_popcnt_epi64(_mm512_maskz_loadu_epi64(mask, words + i)));
+        i = n;
+    }
+    sum = _mm512_reduce_add_epi64(counts);
+#elif defined(__AVX2__)
+    // the popcount of each nibble
+    const __m256i lookup = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                            0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i lowMask = _mm256_set1_epi8(0x0F);
+    __m256i counts = _mm256_setzero_si256();
+    for (; i + 4 <= n; i += 4) {
+        __m256i v = _mm256_loadu_si256((const __m256i*) (words + i));
+        __m256i low = _mm256_shuffle_epi8(lookup, _mm256_and_si256(v, lowMask));
+        __m256i high = _mm256_shuffle_epi8(lookup, _mm256_and_si256(_mm256_srli_epi16(v, 4), lowMask));
+        // sum each word's byte counts into its lane
+        counts = _mm256_add_epi64(counts, _mm256_sad_epu8(_mm256_add_epi8(low, high), _mm256_setzero_si256()));
+    }
+    sum = _mm256_extract_epi64(counts, 0) + _mm256_extract_epi64(counts, 1) +
+          _mm256_extract_epi64(counts, 2) + _mm256_extract_epi64(counts, 3);
+#endif
+    for (; i < n; i++) {
+        sum += std::popcount(words[i]);
+    }
+    return sum;
+}
+
+/** @return The name of the instruction set popcountSum was compiled for. */
+inline const char* popcountSumKernel()
+{
+#if defined(__AVX512VPOPCNTDQ__)
+    return "AVX-512 VPOPCNTDQ";
+#elif defined(__AVX2__)
+    return "AVX2";
+#else
+    return "scalar";
+#endif
+}
+
 }
 
 #endif
@@ -3,6 +3,8 @@
 
 #include <cstdint>
 #include <functional>  // function
+#include <string>
+#include "amt/mapped_file.hpp"
 #include "amt/set.hpp"
 
 namespace amt {
@@ -11,36 +13,77 @@ namespace amt {
  * A set implemented as an array mapped trie (AMT) with tail compression and partial sum support.
  * Unlike the CompressedSumSet, the partial sum is only explicitly stored for tail-compressed nodes
  * and the parent of leaf nodes. The latter requires at most 64 popcount operations on leafs stored
- * in contiguous memory to compute the rank for a value.
+ * in contiguous memory to compute the rank for a value, which are vectorized when possible, or one
+ * lookup if the leaf parents also store the number of keys before each leaf.
  *
- * The structure is built from an existing AMT Set and is immutable.
+ * The structure is built by streaming keys in ascending order, without an intermediate Set, and is
+ * immutable. Nodes are written after their children, once all of their keys have been seen. The
+ * memory is aligned to cache lines and a node is only moved to the next line when it would
+ * otherwise span more lines than it needs, e.g. a leaf parent with 6 leafs is never split.
+ *
+ * The key_codec policy converts between keys and the values stored in tail-compressed nodes; see
+ * Key for the interface it must provide.
  **/
+template <class key_codec>
 class CompressedSumSet
 {
 
-private:
+public:
 
-    typedef std::function<uint64_t(uint8_t*)> GetKey;
-    typedef std::function<void(uint8_t*, uint64_t)> SetKey;
+    /** Returns a new stream of the keys in ascending order. */
+    typedef std::function<Set::NextKey()> KeyStream;
 
-    static const int KNOWN_EMPTY_NODE = 0;
-
-    GetKey getKey;
-    SetKey setKey;
+private:
 
-    int sumCount;
-    int memSize;
+    static const int KNOWN_EMPTY_NODE = 0;
+    // the top bit of a reference marks a tail-compressed node, i.e. its key value and its rank, so
+    // whether a node is compressed is known before it's read
+    static const uint64_t TAIL_FLAG = ((uint64_t) 1) << 63;
+    // the words in a 64 byte cache line
+    static const int LINE_WORDS = 8;
+    // a batch is grouped in windows of this many keys, which are answered by this many interleaved
+    // descents
+    static const int BATCH_WINDOW = 1024;
+    static const int BATCH_LANES = 8;
+    // a saved set is "AMTCSS" and the format version, the key length, leafCounts, the root, the
+    // count, the numWords, the node statistics, the source, and mem; the header is padded to whole
+    // cache lines
+    // so mem is aligned to them when the file is mapped
+    static const uint64_t MAGIC = 0x0001535343544D41;
+    static const int SAVED_HEADER_SIZE = 2 * LINE_WORDS;
+
+    // a predecessor query part way down the trie
+    struct Descent
+    {
+        uint8_t* key;
+        uint64_t keyValue;
+        uint64_t nodeRef;
+        int off;
+        // the deepest node passed that has keys less than the query
+        uint64_t nearestNodeRef;
+        int nearestOff;
+    };
+
+    bool leafCounts;
+    uint64_t source;
+
+    uint64_t nodeCount;
+    uint64_t sumCount;
+    uint64_t leafCountCount;
+    uint64_t padCount;
+    uint64_t numWords;
     uint64_t* mem;
-    bool* compressed;
 
     uint64_t root;
     uint64_t count;
 
-    void computeCompressedSize(Set& set, int len);
-    int computeCompressedSize(Set& set, int len, uint64_t nodeRef, int off);
-    void construct(Set& set, int len);
-    int construct(Set& set, int len, uint64_t nodeRef, uint8_t* key, int off, int& idx, int& sum);
+    // the file the set was loaded from, if any; mem is in it
+    MappedFile file;
 
+    uint64_t construct(Set::NextKey nextKey, bool fill);
+
+    uint64_t leafRank(uint64_t nodeRef, int leaf);
+    bool descend(Descent& descent, uint64_t& rank);
     uint64_t predecessor(uint64_t nodeRef, uint8_t* key, int off, int len);
     //bool successor(uint64_t nodeRef, uint8_t* key, int off, int len);
 
@@ -51,13 +94,37 @@ private:
 
 public:
 
-    void tmp(int len);
+    void tmp();
+
+    /**
+      * @param keys The key streams; it's called twice, once to size the memory exactly and once to
+      *             fill it, and both streams must give the same keys. Duplicate keys are ignored.
+      * @param leafCounts Whether leaf parents store the number of keys before each of their leafs so
+      *                   a rank takes one lookup instead of a popcount of each preceding leaf; costs
+      *                   a quarter word per leaf.
+      * @param source A fingerprint of what the keys were made from, which is saved with the set so
+      *               a set of other keys isn't loaded in its place.
+      * @throws Exception if the keys are not in ascending order.
+      */
+    CompressedSumSet(KeyStream keys, bool leafCounts = false, uint64_t source = 0);
 
-    CompressedSumSet(Set& set, int len, GetKey getKey, SetKey setKey);
+    /**
+      * Loads a saved set without copying its nodes; they're read from the file as they're used, and
+      * processes that load the same file share its pages.
+      *
+      * @param filename The file the set was saved to.
+      * @param source The fingerprint the set must have been built with.
+      * @throws Exception if the file isn't a saved set with keys of key_codec::LENGTH and the
+      *                   given source.
+      */
+    CompressedSumSet(std::string filename, uint64_t source = 0);
     ~CompressedSumSet();
 
     uint64_t size() { return count; };
 
+    /** @return The number of bytes used by the nodes, including the padding. */
+    uint64_t memSize() const { return numWords * sizeof(uint64_t); }
+
     /**
       * Checks if the given uint8_t key exists in the set.
       *
@@ -82,12 +149,27 @@ public:
       * rank. This is equivalent to a paired rank-select query on a bit vector, i.e.
       * select(rank(key)).
       *
-      * @param key The uint8_t key to match that will be updated if a different key is selected.
-      * @param len The length of the uint8_t key.
+      * @param key The uint8_t key of key_codec::LENGTH bytes to match that will be updated if a
+      *            different key is selected.
       * @return The rank of the selected key.
       * @throws Exception if a key is not selected.
       */
-    uint64_t predecessor(uint8_t* key, int len);
+    uint64_t predecessor(uint8_t* key);
+
+    /**
+      * Selects the largest key that is less than or equal to each of a batch of key values and
+      * gets their ranks, like predecessor but without converting to uint8_t keys. The batch is
+      * answered in windows whose keys are grouped by their leading bits, by interleaved descents
+      * that prefetch their next nodes. Each descent starts from the deepest node its previous key
+      * shares with the next one, so a sorted batch is fastest. Nothing is allocated.
+      *
+      * @param values The key values to match, in any order, that are replaced by the selected
+      *               values.
+      * @param ranks The array to store the rank of each selected key in.
+      * @param n The number of values.
+      * @throws Exception if a key is not selected.
+      */
+    void predecessors(uint64_t* values, uint64_t* ranks, uint64_t n);
 
     /**
       * Gets the smallest key that is greater than or equal to the given uint8_t key. This is equivalent
@@ -99,6 +181,15 @@ public:
       */
     //bool successor(uint8_t* key, int len);
 
+    /**
+      * Saves the set so it can be loaded by mapping the file. The file is only replaced once the
+      * set has been written, so a set can be saved to the file it was loaded from.
+      *
+      * @param filename The file to save the set to.
+      * @throws Exception if the file can't be written.
+      */
+    void save(std::string filename);
+
 };
 
 }
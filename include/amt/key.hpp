@@ -24,6 +24,43 @@ int set6Int(uint8_t* key, uint32_t value, int pos = 0);
  */
 uint32_t get6Int(uint8_t* key, int pos = 0);
 
+/**
+ * Converts values to keys of length base 64 digits, most significant digit first, so keys sort like
+ * their values. 6 digits hold 36 bit values and 11 digits hold 64 bit values.
+ *
+ * The codec is a template parameter of the tries that use it so that encoding and decoding are
+ * inlined.
+ **/
+template <int length>
+class Key
+{
+
+public:
+
+    static const int LENGTH = length;
+    static const uint64_t MAX_VALUE = (length * 6 >= 64) ? UINT64_MAX : (((uint64_t) 1) << (length * 6)) - 1;
+
+    static void set(uint8_t* key, uint64_t value)
+    {
+        for (int i = length - 1; i >= 0; i--) {
+            key[i] = (uint8_t) (value & 0x3F);
+            value >>= 6;
+        }
+    }
+
+    static uint64_t get(const uint8_t* key)
+    {
+        uint64_t value = 0;
+        for (int i = 0; i < length; i++) {
+            value = (value << 6) | (key[i] & 0x3F);
+        }
+        return value;
+    }
+};
+
+typedef Key<6> Key6;
+typedef Key<11> Key11;
+
 /**
  * Gets the smallest key byte stored in the given 64 bit value.
  *
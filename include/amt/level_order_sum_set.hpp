@@ -0,0 +1,89 @@
+#ifndef INCLUDED_AMT_LEVEL_ORDER_SUM_SET
+#define INCLUDED_AMT_LEVEL_ORDER_SUM_SET
+
+#include <cstdint>
+#include <functional>  // function
+#include "amt/set.hpp"
+
+namespace amt {
+
+/**
+ * A set implemented as an array mapped trie (AMT) with partial sum support, like the
+ * CompressedSumSet, but encoded in level order without child references. The bitMaps of each
+ * level's nodes are concatenated from left to right, so the children of a node's bits are the
+ * next level's nodes whose index is the number of bits set before them in the level, i.e. a rank
+ * over the level's bitMaps. The last level's bitMaps are the leafs, so the same rank is the number
+ * of keys less than a key and no other partial sums are stored.
+ *
+ * The ranks use a sampled count of the set bits before each block of block_words words, which is
+ * the block's first word and is followed by the bitMaps of block_words - 1 nodes. A rank is the
+ * block's count plus the popcounts of the node's preceding bitMaps in the block, so each level of
+ * a query reads one block; with the default of 8 words, one cache line. Larger blocks use less
+ * space for the counts but take more popcounts.
+ *
+ * The structure is built by streaming keys in ascending order and is immutable. There is no tail
+ * compression, so a key that shares no prefix with others still takes a bitMap at every level.
+ *
+ * The key_codec policy converts between keys and values; see Key for the interface it must
+ * provide.
+ **/
+template <class key_codec, int block_words = 8>
+class LevelOrderSumSet
+{
+
+public:
+
+    /** Returns a new stream of the keys in ascending order. */
+    typedef std::function<Set::NextKey()> KeyStream;
+
+private:
+
+    static const int NODES_PER_BLOCK = block_words - 1;
+
+    // the first word of each level and the number of nodes in it
+    uint64_t levelRefs[key_codec::LENGTH];
+    uint64_t levelSizes[key_codec::LENGTH];
+    uint64_t numWords;
+    uint64_t* mem;
+
+    uint64_t count;
+
+    void construct(Set::NextKey nextKey, bool fill);
+
+    uint64_t& bitMap(int level, uint64_t node);
+    uint64_t rank(int level, uint64_t node, uint64_t bitPos);
+
+public:
+
+    /**
+      * @param keys The key streams; it's called twice, once to size the memory exactly and once to
+      *             fill it, and both streams must give the same keys. Duplicate keys are ignored.
+      * @throws Exception if the keys are not in ascending order.
+      */
+    LevelOrderSumSet(KeyStream keys);
+    ~LevelOrderSumSet();
+
+    LevelOrderSumSet(const LevelOrderSumSet&) = delete;
+    LevelOrderSumSet& operator=(const LevelOrderSumSet&) = delete;
+
+    uint64_t size() { return count; };
+
+    /** @return The number of bytes used by the levels, including the block counts. */
+    uint64_t memSize() const { return numWords * sizeof(uint64_t); }
+
+    /**
+      * Selects the largest key that is less than or equal to the given uint8_t key and returns the
+      * number of keys less than the given key, like CompressedSumSet::predecessor.
+      *
+      * @param key The uint8_t key of key_codec::LENGTH bytes to match that will be updated if a
+      *            different key is selected.
+      * @return The number of keys less than the given key.
+      * @throws Exception if a key is not selected.
+      */
+    uint64_t predecessor(uint8_t* key);
+
+};
+
+}
+
+#endif
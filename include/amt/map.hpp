@@ -2,9 +2,14 @@
 #define INCLUDED_AMT_MAP
 
 #include <cstdint>
+#include <string>
+#include "amt/arena.hpp"
+#include "amt/mapped_file.hpp"
 
 namespace amt {
 
+template <class Trie> class KeyRange;
+
 class MapVisitor
 {
 public:
@@ -21,6 +26,8 @@ public:
 class Map
 {
 
+    template <class Trie> friend class KeyRange;
+
 private:
 
     // maximum node size is 1 (bitMap) + 64 (child pointers or leaf values) + 1 as arrays are zero based
@@ -30,10 +37,15 @@ private:
     static const int KNOWN_DELETED_NODE = 1;
     static const int HEADER_SIZE = 2;  // KNOWN_EMPTY_NODE, KNOWN_DELETED_NODE
 
-    int currentSize;
-    uint64_t* mem;
+    // a saved map is "AMTMAP" and the format version, the root, the count, the nodeCount, the
+    // freeLists, and mem
+    static const uint64_t MAGIC = 0x000150414D544D41;
+    static const int SAVED_HEADER_SIZE = 4 + FREE_LIST_SIZE;
+
+    // the file the map was loaded from, if any; mem's first segments are in it
+    MappedFile file;
+    Arena mem;
     uint64_t* freeLists;
-    uint64_t freeIdx;
 
     uint64_t root;
     uint64_t count;
@@ -62,12 +74,29 @@ private:
 
 public:
 
-    Map(int size);
+    /**
+      * @param size The number of words to reserve up front.
+      * @param hugePages Whether to back the nodes with huge pages when the system allows it.
+      */
+    Map(uint64_t size, bool hugePages = false);
+
+    /**
+      * Loads a saved map without copying its nodes; they're read from the file as they're used.
+      * The map can be modified, and the changes are not written to the file.
+      *
+      * @param filename The file the map was saved to.
+      * @param hugePages Whether to back nodes allocated after loading with huge pages.
+      * @throws Exception if the file isn't a saved map.
+      */
+    Map(std::string filename, bool hugePages = false);
     ~Map();
 
     uint64_t size() { return count; }
     uint64_t nodeSize() { return nodeCount; }
 
+    /** @return The number of bytes reserved for nodes. */
+    uint64_t memSize() { return mem.memSize(); }
+
     /**
       * Adds the given key-value to the map or updates the value if the key already exists.
       *
@@ -155,6 +184,15 @@ public:
       */
     void visitTails(MapTailVisitor& visitor, int len);
 
+    /**
+      * Saves the map so it can be loaded by mapping the file. The file is only replaced once the
+      * map has been written, so a map can be saved to the file it was loaded from.
+      *
+      * @param filename The file to save the map to.
+      * @throws Exception if the file can't be written.
+      */
+    void save(std::string filename);
+
 };
 
 }
@@ -0,0 +1,75 @@
+#ifndef INCLUDED_AMT_MAPPED_FILE
+#define INCLUDED_AMT_MAPPED_FILE
+
+#include <cstdint>
+#include <functional>  // function
+#include <ostream>
+#include <string>
+
+namespace amt {
+
+/**
+ * A saved AMT structure mapped into memory. Saved structures are arrays of 64 bit words in the byte
+ * order of the machine that saved them, and the first word is a magic number that identifies the
+ * structure and the version of its format. The file is mapped copy-on-write, so a structure can
+ * use its words in place without reading them: pages are loaded as they're touched, unmodified
+ * pages are shared by every process that maps the file, and changes are never written back.
+ **/
+class MappedFile
+{
+
+private:
+
+    uint64_t* mapped;
+    uint64_t numWords;
+
+public:
+
+    /** An empty file, for structures that weren't loaded. */
+    MappedFile();
+
+    /**
+      * @param filename The file to map.
+      * @param magic The magic number the file must start with.
+      * @throws Exception if the file can't be mapped or doesn't start with the magic number.
+      */
+    MappedFile(std::string filename, uint64_t magic);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    /** @return Whether a file is mapped. */
+    bool isMapped() const { return mapped != nullptr; }
+
+    /** @return The file's words, starting with the magic number. */
+    uint64_t* words() const { return mapped; }
+
+    /** @return The number of words in the file. */
+    uint64_t size() const { return numWords; }
+
+    /**
+      * Gets the given number of words at an offset, checking that the file has them.
+      *
+      * @param offset The offset of the first word.
+      * @param n The number of words.
+      * @return A pointer to the first word.
+      * @throws Exception if the file is too short.
+      */
+    uint64_t* words(uint64_t offset, uint64_t n) const;
+};
+
+/**
+ * Saves a structure to a file under a unique temporary name and renames it over the file once it's
+ * complete. Processes that have the old file mapped, including the one saving, keep its words, no
+ * process maps a partial file, and concurrent saves of the same file each write their own.
+ *
+ * @param filename The file to save to.
+ * @param write The function that writes the structure's words to a binary stream.
+ * @throws Exception if the file can't be written.
+ */
+void saveFile(std::string filename, std::function<void(std::ostream&)> write);
+
+}
+
+#endif
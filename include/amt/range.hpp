@@ -0,0 +1,212 @@
+#ifndef INCLUDED_AMT_RANGE
+#define INCLUDED_AMT_RANGE
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <ranges>
+#include <stdexcept>
+#include <type_traits>
+#include "amt/arena.hpp"
+#include "amt/map.hpp"
+#include "amt/set.hpp"
+
+namespace amt {
+
+/** A key of a KeyRange and, if the range is over a Map, the key's value. */
+struct RangeEntry
+{
+    uint64_t key;
+    uint64_t value;
+
+    bool operator==(const RangeEntry&) const = default;
+};
+
+/**
+ * A lazy view of the keys of a Map or a Set that are in an inclusive range, in ascending order.
+ * Unlike Map::visitRange, the keys are pulled one at a time by a forward iterator, so a scan can be
+ * paused, composed with std::views, or stopped early, and there's no virtual call per key. Keys are
+ * given as values, i.e. their base 64 digits most significant first, like Key.
+ *
+ * An iterator keeps the path to its key as a stack of the bitMaps left to visit at each level,
+ * already masked to the range, and takes the lowest bit of the deepest one with countr_zero. The
+ * trie must not be modified while the range is used.
+ **/
+template <class Trie>
+class KeyRange : public std::ranges::view_interface<KeyRange<Trie>>
+{
+
+public:
+
+    // the bounds are 64 bit values, which have at most 11 base 64 digits
+    static const int MAX_LENGTH = 11;
+
+private:
+
+    // a Set's last digit is a bit in its leaf parent's leafs instead of a node of its own
+    static const bool LEAF_BITMAPS = std::is_same_v<Trie, Set>;
+
+    const Arena* mem;
+    uint64_t root;
+    int len;
+    bool empty;
+    uint8_t lower[MAX_LENGTH];
+    uint8_t upper[MAX_LENGTH];
+
+public:
+
+    class Iterator
+    {
+
+    private:
+
+        const KeyRange* range;
+        bool done;
+        int depth;
+        // the path to the current key: each level's node, its bitMap, the bits left to visit, the
+        // key's digits above the level, and whether they're the bounds' digits
+        uint64_t nodeRefs[MAX_LENGTH];
+        uint64_t bitMaps[MAX_LENGTH];
+        uint64_t bits[MAX_LENGTH];
+        uint64_t prefixes[MAX_LENGTH];
+        bool onLower[MAX_LENGTH];
+        bool onUpper[MAX_LENGTH];
+        RangeEntry entry;
+
+        // reads the node at the given level and masks its bitMap to the range
+        void enter(int level, uint64_t value)
+        {
+            if (KeyRange::LEAF_BITMAPS && level == range->len - 1) {
+                bitMaps[level] = value;
+            } else {
+                nodeRefs[level] = value;
+                bitMaps[level] = (*range->mem)[value];
+            }
+            uint64_t mask = ~((uint64_t) 0);
+            if (onLower[level]) {
+                mask &= ~((((uint64_t) 1) << range->lower[level]) - 1);
+            }
+            if (onUpper[level]) {
+                mask &= (((uint64_t) 2) << range->upper[level]) - 1;
+            }
+            bits[level] = bitMaps[level] & mask;
+        }
+
+        // moves to the next key in the range, or to the end
+        void advance()
+        {
+            int level = depth;
+            for (;;) {
+                if (bits[level] == 0) {
+                    if (level == 0) {
+                        done = true;
+                        return;
+                    }
+                    level--;
+                    continue;
+                }
+                uint64_t bitPos = bits[level] & -bits[level];
+                bits[level] ^= bitPos;
+                int digit = std::countr_zero(bitPos);
+                uint64_t key = (prefixes[level] << 6) | digit;
+
+                // at a key
+                if (level == range->len - 1) {
+                    entry.key = key;
+                    entry.value = 0;
+                    if (!KeyRange::LEAF_BITMAPS) {
+                        entry.value = (*range->mem)[nodeRefs[level] + 1 + std::popcount(bitMaps[level] & (bitPos - 1))];
+                    }
+                    depth = level;
+                    return;
+                }
+
+                // descend to the child
+                uint64_t value = (*range->mem)[nodeRefs[level] + 1 + std::popcount(bitMaps[level] & (bitPos - 1))];
+                prefixes[level + 1] = key;
+                onLower[level + 1] = onLower[level] && digit == range->lower[level];
+                onUpper[level + 1] = onUpper[level] && digit == range->upper[level];
+                enter(++level, value);
+            }
+        }
+
+    public:
+
+        typedef std::forward_iterator_tag iterator_concept;
+        typedef std::forward_iterator_tag iterator_category;
+        typedef RangeEntry value_type;
+        typedef std::ptrdiff_t difference_type;
+
+        Iterator(): range(nullptr), done(true) { }
+
+        Iterator(const KeyRange* range): range(range), done(range->empty), depth(0)
+        {
+            if (done) return;
+            prefixes[0] = 0;
+            onLower[0] = true;
+            onUpper[0] = true;
+            enter(0, range->root);
+            advance();
+        }
+
+        RangeEntry operator*() const { return entry; }
+
+        Iterator& operator++()
+        {
+            advance();
+            return *this;
+        }
+
+        Iterator operator++(int)
+        {
+            Iterator previous = *this;
+            advance();
+            return previous;
+        }
+
+        bool operator==(const Iterator& other) const
+        {
+            return done == other.done && (done || entry.key == other.entry.key);
+        }
+
+        bool operator==(std::default_sentinel_t) const { return done; }
+    };
+
+    KeyRange(): mem(nullptr), root(0), len(0), empty(true) { }
+
+    /**
+      * @param trie The Map or Set; it must outlive the range.
+      * @param begin The smallest key value in the range.
+      * @param end The largest key value in the range.
+      * @param len The length of the trie's keys.
+      * @throws Exception if the keys are longer than MAX_LENGTH.
+      */
+    KeyRange(const Trie& trie, uint64_t begin, uint64_t end, int len): mem(&trie.mem), root(trie.root), len(len)
+    {
+        if (len < 1 || len > KeyRange::MAX_LENGTH || (KeyRange::LEAF_BITMAPS && len < 2)) {
+            throw std::runtime_error("key length not supported by ranges");
+        }
+        // keys can't be larger than their digits allow
+        if (6 * len < 64) {
+            end = std::min(end, (((uint64_t) 1) << (6 * len)) - 1);
+        }
+        empty = root == Trie::KNOWN_EMPTY_NODE || begin > end;
+        for (int i = len - 1; i >= 0; i--) {
+            lower[i] = (uint8_t) (begin & 0x3F);
+            upper[i] = (uint8_t) (end & 0x3F);
+            begin >>= 6;
+            end >>= 6;
+        }
+    }
+
+    Iterator begin() const { return Iterator(this); }
+
+    std::default_sentinel_t end() const { return std::default_sentinel; }
+
+};
+
+}
+
+#endif
@@ -2,13 +2,26 @@
 #define INCLUDED_AMT_SET
 
 #include <cstdint>
+#include <functional>  // function
+#include <string>
+#include "amt/arena.hpp"
+#include "amt/mapped_file.hpp"
 
 namespace amt {
 
+template <class Trie> class KeyRange;
+
 /** A set implemented as an array mapped trie. */
 class Set
 {
 
+    template <class Trie> friend class KeyRange;
+
+public:
+
+    /** Writes the next key to the array and returns true, or returns false if there are none left. */
+    typedef std::function<bool(uint8_t*)> NextKey;
+
 private:
 
     // maximum node size is 1 (bitMap) + 64 (child pointers or leaf values) + 1 as arrays are zero based
@@ -18,19 +31,26 @@ private:
     static const int KNOWN_DELETED_NODE = 1;
     static const int HEADER_SIZE = 2;  // KNOWN_EMPTY_NODE, KNOWN_DELETED_NODE
 
-    int currentSize;
-    //uint64_t* mem;
+    // a saved set is "AMTSET" and the format version, the root, the count, the freeLists, and mem
+    static const uint64_t MAGIC = 0x0001544553544D41;
+    static const int SAVED_HEADER_SIZE = 3 + FREE_LIST_SIZE;
+
     uint64_t* freeLists;
-    //uint64_t freeIdx;
 
     //uint64_t root;
     uint64_t count;
 
+    // the file the set was loaded from, if any; mem's first segments are in it
+    MappedFile file;
+
     uint64_t allocate(int size);
     uint64_t allocateInsert(uint64_t nodeIdx, int size, int childIdx);
     uint64_t allocateDelete(uint64_t nodeIdx, int size, int childIdx);
     void deallocate(uint64_t idx, int size);
 
+    void bulkLoad(NextKey nextKey, int len);
+    uint64_t writeNode(uint64_t bitMap, uint64_t* children);
+
     uint64_t createLeaf(uint8_t* key, int off, int len);
     uint64_t insertChild(uint64_t nodeRef, uint64_t bitMap, uint64_t bitPos, int idx, uint64_t value);
     uint64_t removeChild(uint64_t nodeRef, uint64_t bitMap, uint64_t bitPos, int idx);
@@ -48,15 +68,42 @@ public:
     void tmp(uint64_t nodeRef, uint8_t* key, int off, int len);
 
     // TODO: make private
-    uint64_t* mem;
+    Arena mem;
     uint64_t root;
-    uint64_t freeIdx;
 
-    Set(int size);
+    /**
+      * @param size The number of words to reserve up front.
+      * @param hugePages Whether to back the nodes with huge pages when the system allows it.
+      */
+    Set(uint64_t size, bool hugePages = false);
+
+    /**
+      * Builds a set from keys in ascending order bottom-up in a single pass. Each node is written
+      * once, with exactly the space it needs, after all of its keys have been seen.
+      *
+      * @param nextKey The function that gets the keys; duplicate keys are ignored.
+      * @param len The length of the uint8_t keys.
+      * @param hugePages Whether to back the nodes with huge pages when the system allows it.
+      * @throws Exception if the keys are not in ascending order.
+      */
+    Set(NextKey nextKey, int len, bool hugePages = false);
+
+    /**
+      * Loads a saved set without copying its nodes; they're read from the file as they're used.
+      * The set can be modified, and the changes are not written to the file.
+      *
+      * @param filename The file the set was saved to.
+      * @param hugePages Whether to back nodes allocated after loading with huge pages.
+      * @throws Exception if the file isn't a saved set.
+      */
+    Set(std::string filename, bool hugePages = false);
     ~Set();
 
     uint64_t size() { return count; };
 
+    /** @return The number of bytes reserved for nodes. */
+    uint64_t memSize() { return mem.memSize(); }
+
     /**
       * Adds the given uint8_t key to the set.
       *
@@ -104,6 +151,15 @@ public:
       */
     bool clear(uint8_t* key, int len);
 
+    /**
+      * Saves the set so it can be loaded by mapping the file. The file is only replaced once the
+      * set has been written, so a set can be saved to the file it was loaded from.
+      *
+      * @param filename The file to save the set to.
+      * @throws Exception if the file can't be written.
+      */
+    void save(std::string filename);
+
 };
 
 }
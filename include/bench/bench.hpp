@@ -0,0 +1,158 @@
+#ifndef INCLUDED_BENCH_BENCH
+#define INCLUDED_BENCH_BENCH
+
+#include <cstdint>
+#include <string>
+#include "cfg/cfg.hpp"
+#include "xoroshiro/xoroshiro128plus.hpp"
+
+namespace bench {
+
+/**
+ * Computes the text positions where the characters of a CFG's start rule begin.
+ *
+ * @param cfg The grammar.
+ * @return An array of cfg->startSize sorted positions that the caller must delete.
+ */
+uint64_t* startPositions(cfg::CFG* cfg);
+
+/**
+ * Microbenchmarks the start rule lookup that begins every random access query, comparing the
+ * fused Elias-Fano predecessor against the separate rank and select queries, the other start index
+ * layouts and the AMT answering batches of queries.
+ *
+ * @param cfg The grammar whose start rule positions are indexed.
+ * @param eng The pseudo-random number generator used to generate query positions.
+ * @param numQueries The number of lookups to time per loop.
+ */
+void startIndex(cfg::CFG* cfg, xoroshiro::xoroshiro128plus_engine& eng, uint32_t numQueries);
+
+/**
+ * Compares the size and predecessor time of the start index layouts on synthetic start rules of
+ * increasing size whose phrase lengths are drawn from the grammar's start rule.
+ *
+ * @param cfg The grammar whose start rule phrase lengths are sampled.
+ * @param eng The pseudo-random number generator used to generate positions and queries.
+ * @param numQueries The number of lookups to time per loop.
+ */
+void startIndexSweep(cfg::CFG* cfg, xoroshiro::xoroshiro128plus_engine& eng, uint32_t numQueries);
+
+/**
+ * Compares counting and locating random patterns on the grammar against scanning the decompressed
+ * text, checking that all methods find the same occurrences.
+ *
+ * @param cfg The grammar to search.
+ * @param eng The pseudo-random number generator used to sample patterns from the text.
+ * @param patternSize The length of the patterns.
+ * @param numQueries The number of patterns to search for.
+ */
+void patternMatching(cfg::CFG* cfg, xoroshiro::xoroshiro128plus_engine& eng, uint32_t patternSize, uint32_t numQueries);
+
+/**
+ * Compares fingerprint based substring equality against extracting and comparing the substrings,
+ * and times longest common extension queries, checking the answers against the decompressed text.
+ *
+ * @param cfg The grammar whose text is queried.
+ * @param eng The pseudo-random number generator used to generate query positions.
+ * @param querySize The length of the substrings to compare.
+ * @param numQueries The number of queries to run.
+ */
+void fingerprints(cfg::CFG* cfg, xoroshiro::xoroshiro128plus_engine& eng, uint32_t querySize, uint32_t numQueries);
+
+/**
+ * Compares counting the most frequent bytes in random ranges with per-rule counts against
+ * extracting the ranges and counting their bytes, checking that the histograms agree.
+ *
+ * @param cfg The grammar whose text is queried.
+ * @param eng The pseudo-random number generator used to generate query ranges.
+ * @param querySize The length of the ranges.
+ * @param numQueries The number of queries to run.
+ */
+void rangeCounts(cfg::CFG* cfg, xoroshiro::xoroshiro128plus_engine& eng, uint32_t querySize, uint32_t numQueries);
+
+/**
+ * Times line access with per-rule newline counts: selecting a line, finding the line of a position,
+ * and getting a line with a single descent compared to selecting its bounds and extracting it.
+ * The answers are checked against the decompressed text.
+ *
+ * @param cfg The grammar whose newline-delimited text is queried.
+ * @param eng The pseudo-random number generator used to generate queries.
+ * @param numQueries The number of queries to run.
+ */
+void lines(cfg::CFG* cfg, xoroshiro::xoroshiro128plus_engine& eng, uint32_t numQueries);
+
+/**
+ * Compares running a pattern's DFA over the grammar with memoized rule transitions against running
+ * it over the decompressed text, checking that both find the same matches.
+ *
+ * @param cfg The grammar to scan.
+ * @param eng The pseudo-random number generator used to sample patterns from the text.
+ * @param patternSize The length of the patterns.
+ * @param numQueries The number of patterns to scan for.
+ */
+void grep(cfg::CFG* cfg, xoroshiro::xoroshiro128plus_engine& eng, uint32_t patternSize, uint32_t numQueries);
+
+/**
+ * Compares decompressing the whole text with a single random access query against the parallel
+ * extractor with increasing numbers of threads, checking that the outputs agree.
+ *
+ * @param cfg The grammar to decompress.
+ */
+void extract(cfg::CFG* cfg);
+
+/**
+ * Compares writing the whole text through the output sinks: per-character random access into a
+ * buffer or file descriptor, and parallel extraction into a write-combining file descriptor, writev
+ * and vmsplice. Each file descriptor sink's output is first checked through a pipe.
+ *
+ * @param cfg The grammar to decompress.
+ */
+void sinks(cfg::CFG* cfg);
+
+/**
+ * Times inserting random keys into AMT Sets and Maps in random and sorted order, and bulk loading
+ * them into a Set, with and without huge pages, and reports the insert throughput, the memory
+ * reserved by the arenas, and the process's peak RSS.
+ *
+ * @param eng The pseudo-random number generator used to generate keys.
+ * @param numKeys The number of keys to generate.
+ */
+void amtInsert(xoroshiro::xoroshiro128plus_engine& eng, uint32_t numKeys);
+
+/**
+ * Times predecessor queries on CompressedSumSets of random keys, spread over 32 bits and with small
+ * gaps like a grammar's phrase starts, with 6 and 11 digit keys and with and without leaf counts,
+ * and compares them with the pointerless LevelOrderSumSets and an sd_vector. Reports the average
+ * query time and the memory used.
+ *
+ * @param eng The pseudo-random number generator used to generate keys and queries.
+ * @param numKeys The number of keys and queries to generate.
+ */
+void amtPredecessor(xoroshiro::xoroshiro128plus_engine& eng, uint32_t numKeys);
+
+/**
+ * Times scanning random ranges of about 1000 keys of a Map and a Set of random keys with lazy
+ * KeyRanges and with the Map's visitor, and taking just the first keys of a range, checking that
+ * the scans agree.
+ *
+ * @param eng The pseudo-random number generator used to generate keys and ranges.
+ * @param numKeys The number of keys to generate.
+ */
+void amtRange(xoroshiro::xoroshiro128plus_engine& eng, uint32_t numKeys);
+
+/**
+ * Generates load on a query server: each connection keeps a number of random queries in flight and
+ * the throughput and latency percentiles over all the queries are reported.
+ *
+ * @param socketPath The server's Unix domain socket.
+ * @param eng The pseudo-random number generator used to seed the connections' query ranges.
+ * @param querySize The length of the ranges.
+ * @param numQueries The total number of queries to run.
+ * @param numConnections The number of connections, each on its own thread.
+ * @param depth The number of queries each connection keeps in flight.
+ */
+void client(std::string socketPath, xoroshiro::xoroshiro128plus_engine& eng, uint32_t querySize, uint32_t numQueries, uint32_t numConnections, uint32_t depth);
+
+}
+
+#endif
@@ -0,0 +1,68 @@
+#ifndef INCLUDED_CFG_BATCH_EXTRACTOR
+#define INCLUDED_CFG_BATCH_EXTRACTOR
+
+#include <cstdint>
+#include <exception>
+#include <mutex>
+#include <vector>
+#include "cfg/cfg.hpp"
+#include "cfg/random_access_v2.hpp"
+
+namespace cfg {
+
+/**
+ * Extracts batches of substrings whose (begin, end) pairs are read from a file descriptor and
+ * writes them to another file descriptor as records, each an 8 byte little-endian length followed by
+ * that many characters. Parsing, querying and writing run on separate threads connected by bounded
+ * queues of batches, so the input and output are streamed while the index is queried.
+ **/
+class BatchExtractor
+{
+
+private:
+
+    // a batch ends after this many ranges or once its records are this many bytes
+    static const uint64_t BATCH_RANGES = 4096;
+    static const uint64_t BATCH_BYTES = 1 << 23;
+    // the number of batches each queue holds
+    static const uint64_t QUEUE_CAPACITY = 4;
+
+    struct Range
+    {
+        uint64_t begin;
+        uint64_t end;
+    };
+
+    CFG* cfg;
+    RandomAccessV2& index;
+
+    // the first error thrown by a stage
+    std::exception_ptr error;
+    std::mutex errorMutex;
+
+public:
+
+    /**
+      * @param cfg The grammar whose text is extracted.
+      * @param index The index to extract substrings with; it's only used by the query thread.
+      */
+    BatchExtractor(CFG* cfg, RandomAccessV2& index): cfg(cfg), index(index) { }
+
+    BatchExtractor(const BatchExtractor&) = delete;
+    BatchExtractor& operator=(const BatchExtractor&) = delete;
+
+    /**
+      * Extracts the substrings of all the ranges in the input. The end of each range is exclusive.
+      *
+      * @param inFd The file descriptor to read ranges from.
+      * @param outFd The file descriptor to write records to.
+      * @return The number of records written.
+      * @throws Exception if the input is malformed, a range is out of bounds, or the output can't
+      *     be written.
+      */
+    uint64_t run(int inFd, int outFd);
+};
+
+}
+
+#endif
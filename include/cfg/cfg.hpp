@@ -43,6 +43,13 @@ public:
         return sizeof(int) * (startSize + rulesSize);
     }
 
+    /**
+     * Computes the expansion length of every character except the start rule.
+     *
+     * @return An array of the lengths indexed by character that the caller must delete.
+     */
+    uint64_t* expansionSizes();
+
     CFG();
     ~CFG();
 
@@ -0,0 +1,63 @@
+#ifndef INCLUDED_CFG_DFA
+#define INCLUDED_CFG_DFA
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "cfg/cfg.hpp"
+
+namespace cfg {
+
+/**
+ * A deterministic finite automaton over bytes. A DFA used for scanning should accept every text
+ * that ends with a match, i.e. it recognizes .*R for some language R, so that it enters an
+ * accepting state at the last character of every match.
+ **/
+class DFA
+{
+
+private:
+
+    int numStates;
+    int startState;
+    std::vector<int> transitions;
+    std::vector<bool> accepting;
+
+public:
+
+    /**
+      * @param numStates The number of states.
+      * @param startState The state the automaton starts in.
+      * @param transitions The next state for each state and byte, indexed by state * 256 + byte.
+      * @param accepting Whether each state is accepting.
+      * @throws Exception if the transitions or accepting states don't match the number of states.
+      */
+    DFA(int numStates, int startState, std::vector<int> transitions, std::vector<bool> accepting);
+
+    /**
+      * Builds the Knuth-Morris-Pratt automaton that enters its accepting state at the last
+      * character of every occurrence of a pattern.
+      *
+      * @param pattern The pattern to search for.
+      * @return The automaton.
+      * @throws Exception if the pattern is empty.
+      */
+    static DFA fromPattern(std::string pattern);
+
+    int getNumStates() const { return numStates; }
+    int getStartState() const { return startState; }
+
+    int next(int state, int c) const
+    {
+        return transitions[state * CFG::ALPHABET_SIZE + c];
+    }
+
+    bool isAccepting(int state) const
+    {
+        return accepting[state];
+    }
+};
+
+}
+
+#endif
@@ -0,0 +1,133 @@
+#ifndef INCLUDED_CFG_DFA_SCANNER
+#define INCLUDED_CFG_DFA_SCANNER
+
+#include <cstdint>
+#include "cfg/cfg.hpp"
+#include "cfg/dfa.hpp"
+
+namespace cfg {
+
+/**
+ * Runs a DFA over the text of a CFG without decompressing it. The state a rule's expansion leads
+ * each DFA state to, and whether an accepting state is entered within the expansion, are computed
+ * once and memoized per (rule, state). A scan then only walks the start rule, the rules whose
+ * transitions aren't memoized yet, and the rules that contain a match.
+ *
+ * The memo is filled lazily by scans or eagerly by fill(), which computes it bottom-up because
+ * the rules are ordered shortest-first.
+ * NOTE: this class requires that the CFG rules are in smallest-expansion-first order.
+ **/
+class DFAScanner
+{
+
+private:
+
+    static const uint32_t UNKNOWN = UINT32_MAX;
+
+    CFG* cfg;
+    const DFA& dfa;
+    int numStates;
+
+    uint64_t* ruleSizes;
+
+    // (next state << 1) | accepts inside for each rule and state, indexed by
+    // (rule - ALPHABET_SIZE) * numStates + state
+    uint32_t* memo;
+    uint64_t numMemoized;
+
+    uint32_t computeTransition(int rule, int state);
+
+    /**
+      * Gets the memoized transition of a rule, computing it if necessary.
+      *
+      * @return (next state << 1) | whether an accepting state is entered within the expansion.
+      */
+    uint32_t transition(int rule, int state)
+    {
+        uint32_t& t = memo[(uint64_t) (rule - CFG::ALPHABET_SIZE) * numStates + state];
+        if (t == UNKNOWN) {
+            t = computeTransition(rule, state);
+            numMemoized++;
+        }
+        return t;
+    }
+
+    /**
+      * Runs the DFA over a rule's expansion, descending into the characters that contain a match.
+      *
+      * @return False if the callback stopped the scan.
+      */
+    template <class Callback>
+    bool scanRule(int rule, int& state, uint64_t& position, Callback& callback)
+    {
+        int c;
+        uint32_t t;
+        for (int i = 0; (c = cfg->rules[rule][i]) != CFG::DUMMY_CODE; i++) {
+            // terminal character
+            if (c < CFG::ALPHABET_SIZE) {
+                state = dfa.next(state, c);
+                if (dfa.isAccepting(state) && !callback(position)) return false;
+                position++;
+                continue;
+            }
+            // non-terminal character
+            t = transition(c, state);
+            if (t & 1) {
+                if (!scanRule(c, state, position, callback)) return false;
+            } else {
+                state = t >> 1;
+                position += ruleSizes[c];
+            }
+        }
+        return true;
+    }
+
+public:
+
+    /**
+      * @param cfg The grammar to scan.
+      * @param dfa The automaton to run; it must outlive the scanner.
+      * @throws Exception if the DFA has too many states to memoize.
+      */
+    DFAScanner(CFG* cfg, const DFA& dfa);
+    ~DFAScanner();
+
+    DFAScanner(const DFAScanner&) = delete;
+    DFAScanner& operator=(const DFAScanner&) = delete;
+
+    uint64_t memSize();
+
+    /** The number of (rule, state) transitions that have been memoized. */
+    uint64_t getNumMemoized() const { return numMemoized; }
+
+    /** Memoizes the transitions of every rule and state bottom-up. */
+    void fill();
+
+    /**
+      * Calls a function with the text position of the last character of every match, in order.
+      *
+      * @param callback A function that takes a position and returns false to stop the scan.
+      */
+    template <class Callback>
+    void forEachMatch(Callback callback)
+    {
+        int state = dfa.getStartState();
+        uint64_t position = 0;
+        scanRule(cfg->startRule, state, position, callback);
+    }
+
+    /**
+      * Finds the first match in the text.
+      *
+      * @param position The text position of the last character of the first match.
+      * @return True if the text contains a match.
+      */
+    bool firstMatch(uint64_t& position);
+
+    /** @return The number of matches in the text. */
+    uint64_t count();
+};
+
+}
+
+#endif
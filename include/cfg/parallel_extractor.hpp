@@ -0,0 +1,129 @@
+#ifndef INCLUDED_CFG_PARALLEL_EXTRACTOR
+#define INCLUDED_CFG_PARALLEL_EXTRACTOR
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "cfg/cfg.hpp"
+#include "io/sink.hpp"
+
+namespace cfg {
+
+/**
+ * Decompresses large ranges of a CFG's text, e.g. the whole text, on multiple threads. The range is
+ * split into pieces at start rule phrase boundaries, or inside a phrase's subtree when phrases are
+ * large, and the threads take pieces until there are none left. Each thread remembers where it
+ * last wrote the full expansion of recent rules and copies repeated expansions from there instead
+ * of walking their subtrees again.
+ * NOTE: this class requires that the CFG rules are in smallest-expansion-first order.
+ **/
+class ParallelExtractor
+{
+
+private:
+
+    // the number of pieces per thread so threads that finish early can take more
+    static const int PIECES_PER_THREAD = 8;
+    static const uint64_t MIN_PIECE_SIZE = 1 << 16;
+
+    // the number of entries in each thread's direct mapped cache of expansion positions
+    static const int MEMO_BITS = 14;
+    static const uint64_t PARTIAL = UINT64_MAX;
+
+    // the size of the windows a range is extracted in when it's written to a sink
+    static const uint64_t SINK_WINDOW_SIZE = 1 << 24;
+
+    struct Frame
+    {
+        int rule;
+        int index;
+        // where the rule's expansion begins in the output, or PARTIAL if it isn't all output
+        uint64_t begin;
+    };
+
+    struct Memo
+    {
+        int rule;
+        uint64_t begin;
+    };
+
+    CFG* cfg;
+    int numThreads;
+
+    uint64_t* ruleSizes;
+    // the text position of each start rule character and the text length
+    uint64_t* startPositions;
+
+    /**
+      * Splits a range into pieces, moving each split to the start rule phrase boundary before it
+      * if that is near enough.
+      *
+      * @return The piece boundaries, beginning with begin and ending with end.
+      */
+    std::vector<uint64_t> split(uint64_t begin, uint64_t end);
+
+    /**
+      * Decodes a piece of a range.
+      *
+      * @param out The output of the whole range.
+      * @param begin The start position of the piece in the text.
+      * @param end The end position (exclusive) of the piece in the text.
+      * @param offset The position of the piece in out.
+      * @param stack The thread's stack.
+      * @param memo The thread's expansion position cache.
+      */
+    void decode(char* out, uint64_t begin, uint64_t end, uint64_t offset, std::vector<Frame>& stack, Memo* memo);
+
+public:
+
+    /**
+      * @param cfg The grammar to decompress.
+      * @param numThreads The number of threads to use; 0 uses one per hardware thread.
+      */
+    ParallelExtractor(CFG* cfg, int numThreads = 0);
+    ~ParallelExtractor();
+
+    ParallelExtractor(const ParallelExtractor&) = delete;
+    ParallelExtractor& operator=(const ParallelExtractor&) = delete;
+
+    uint64_t memSize();
+
+    int getNumThreads() const { return numThreads; }
+
+    /**
+      * Gets a substring in the original string.
+      *
+      * @param out The array to write the substring to.
+      * @param begin The start position of the substring in the original string.
+      * @param end The end position (exclusive) of the substring in the original string.
+      * @throws Exception if begin or end is out of bounds.
+      */
+    void extract(char* out, uint64_t begin, uint64_t end);
+
+    /**
+      * Writes a substring of the original string to a sink. The substring is extracted in windows
+      * that are each written to the sink and flushed, so the sink may reference a window instead of
+      * copying it.
+      *
+      * @param out The sink to write the substring to.
+      * @param begin The start position of the substring in the original string.
+      * @param end The end position (exclusive) of the substring in the original string.
+      * @throws Exception if begin or end is out of bounds or the sink can't be written.
+      */
+    void extract(io::Sink& out, uint64_t begin, uint64_t end);
+
+    /**
+      * Writes a substring of the original string to a file by decoding it directly into the
+      * file's memory mapped pages.
+      *
+      * @param filename The file to write; it is created or truncated.
+      * @param begin The start position of the substring in the original string.
+      * @param end The end position (exclusive) of the substring in the original string.
+      * @throws Exception if begin or end is out of bounds or the file can't be written.
+      */
+    void extractToFile(std::string filename, uint64_t begin, uint64_t end);
+};
+
+}
+
+#endif
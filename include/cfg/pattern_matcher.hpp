@@ -0,0 +1,83 @@
+#ifndef INCLUDED_CFG_PATTERN_MATCHER
+#define INCLUDED_CFG_PATTERN_MATCHER
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "cfg/cfg.hpp"
+
+namespace cfg {
+
+/**
+ * Counts and locates the occurrences of a pattern in the text of a CFG without decompressing it.
+ * Every occurrence lies inside exactly one rule such that it is not inside any of the rule's
+ * characters, i.e. it crosses a boundary between the rule's characters. These crossing occurrences
+ * are found for each rule once using the first and last m-1 characters of the rule's characters
+ * and Karp-Rabin fingerprints, and the counts are then propagated through the grammar. The time
+ * and space grow with the size of the grammar and the pattern, not the length of the text.
+ * NOTE: this class requires that the CFG rules are in smallest-expansion-first order.
+ **/
+class PatternMatcher
+{
+
+private:
+
+    // Karp-Rabin fingerprints are computed modulo 2^64; matching fingerprints are verified so
+    // collisions only cost a comparison
+    static const uint64_t BASE = 0x100000001b3;
+
+    CFG* cfg;
+    std::string pattern;
+    uint64_t m;
+    uint64_t patternFingerprint;
+    uint64_t highestPower;  // BASE^(m-1)
+
+    uint64_t* ruleSizes;
+    uint64_t* counts;
+
+    // the offsets of the crossing occurrences in each rule's expansion, relative to its start
+    std::vector<uint64_t>* crossings;
+
+    void initializeCounts();
+
+    /**
+      * Finds the occurrences in a window that start before the boundary and end after it.
+      *
+      * @param window The characters on both sides of the boundary.
+      * @param size The number of characters in the window.
+      * @param boundary The position in the window of the first character after the boundary.
+      * @param offset The offset of the window in the rule's expansion.
+      * @param occurrences The offsets of the occurrences are appended to this vector.
+      */
+    void findCrossings(const char* window, uint64_t size, uint64_t boundary, uint64_t offset, std::vector<uint64_t>& occurrences);
+
+public:
+
+    /**
+      * @param cfg The grammar to search.
+      * @param pattern The pattern to search for.
+      * @throws Exception if the pattern is empty.
+      */
+    PatternMatcher(CFG* cfg, std::string pattern);
+    ~PatternMatcher();
+
+    PatternMatcher(const PatternMatcher&) = delete;
+    PatternMatcher& operator=(const PatternMatcher&) = delete;
+
+    uint64_t memSize();
+
+    /** @return The number of occurrences of the pattern in the text. */
+    uint64_t count();
+
+    /**
+      * Computes the text positions of the occurrences of the pattern by traversing the parse tree
+      * and skipping the subtrees that contain no occurrences.
+      *
+      * @return The sorted text positions of the occurrences.
+      */
+    std::vector<uint64_t> locate();
+};
+
+}
+
+#endif
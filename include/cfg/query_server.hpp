@@ -0,0 +1,149 @@
+#ifndef INCLUDED_CFG_QUERY_SERVER
+#define INCLUDED_CFG_QUERY_SERVER
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "cfg/cfg.hpp"
+#include "cfg/random_access_v2.hpp"
+
+namespace cfg {
+
+/**
+ * Serves random access queries to a loaded index over a Unix domain socket so clients can share
+ * one copy of a grammar and its index.
+ *
+ * The protocol is binary and all integers are 8 byte little-endian. A request is a (begin, end)
+ * pair for the substring [begin, end). Its response is the substring's length followed by the
+ * substring, or ERROR with no characters if the range is out of bounds or longer than
+ * MAX_RESPONSE_LENGTH. A request of (INFO, INFO)
+ * is answered with the text length and no characters. Clients may pipeline any number of requests;
+ * each connection's responses are sent in the order of its requests.
+ *
+ * The server runs a single-threaded epoll event loop. All the requests that arrive on any
+ * connection during one wait are executed as a batch in text order, and their responses are
+ * written in place in each connection's output buffer.
+ **/
+class QueryServer
+{
+
+public:
+
+    static const uint64_t INFO = UINT64_MAX;
+    static const uint64_t ERROR = UINT64_MAX;
+    static const uint64_t REQUEST_SIZE = 2 * sizeof(uint64_t);
+    // longer ranges must be requested in pieces
+    static const uint64_t MAX_RESPONSE_LENGTH = 1 << 26;
+
+    static void putUint64(char* out, uint64_t value)
+    {
+        for (int i = 0; i < 8; i++) {
+            out[i] = (char) (value >> (8 * i));
+        }
+    }
+
+    static uint64_t getUint64(const char* in)
+    {
+        uint64_t value = 0;
+        for (int i = 0; i < 8; i++) {
+            value |= ((uint64_t) (unsigned char) in[i]) << (8 * i);
+        }
+        return value;
+    }
+
+private:
+
+    // a connection stops being read once this many response bytes are waiting to be sent, so its
+    // output buffer holds at most this plus one response
+    static const uint64_t MAX_PENDING_OUTPUT = 1 << 26;
+    // the most bytes read from a connection per wakeup, so a fast client can't starve the others
+    static const uint64_t MAX_READ_SIZE = 1 << 18;
+    static const int MAX_EVENTS = 64;
+
+    struct Connection
+    {
+        int fd;
+        std::vector<char> in;
+        uint64_t inPosition = 0;
+        std::vector<char> out;
+        uint64_t outPosition = 0;
+        // the events the connection is registered for
+        uint32_t events = 0;
+        bool peerClosed = false;
+    };
+
+    struct Job
+    {
+        uint64_t begin;
+        uint64_t end;
+        Connection* connection;
+        // where the job's characters go in the connection's output buffer
+        uint64_t offset;
+    };
+
+    CFG* cfg;
+    RandomAccessV2& index;
+    std::string socketPath;
+
+    int listenFd;
+    int signalFd;
+    int epollFd;
+    std::unordered_map<int, Connection*> connections;
+    std::vector<Job> jobs;
+
+    uint64_t numRequests;
+    uint64_t numBatches;
+
+    void accept();
+
+    /** @return False if the connection failed. */
+    bool read(Connection* connection);
+
+    /** @return False if the connection failed. */
+    bool write(Connection* connection);
+
+    /** Queues the connection's complete requests as jobs and reserves their responses. */
+    void parse(Connection* connection);
+
+    /** Executes the queued jobs in text order. */
+    void execute();
+
+    /**
+      * Registers the connection for the events it needs, or closes it if it's done.
+      *
+      * @return False if the connection was closed.
+      */
+    bool update(Connection* connection);
+
+    void close(Connection* connection);
+
+public:
+
+    /**
+      * @param cfg The grammar whose text is served.
+      * @param index The index to answer queries with.
+      * @param socketPath The path to bind the socket to; an existing socket file is replaced.
+      * @throws Exception if the socket can't be created.
+      */
+    QueryServer(CFG* cfg, RandomAccessV2& index, std::string socketPath);
+    ~QueryServer();
+
+    QueryServer(const QueryServer&) = delete;
+    QueryServer& operator=(const QueryServer&) = delete;
+
+    /**
+      * Serves requests until SIGINT or SIGTERM is received.
+      *
+      * @throws Exception if the event loop fails.
+      */
+    void run();
+
+    uint64_t getNumRequests() const { return numRequests; }
+
+    uint64_t getNumBatches() const { return numBatches; }
+};
+
+}
+
+#endif
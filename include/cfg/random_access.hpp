@@ -3,6 +3,7 @@
 
 #include <ostream>
 #include "cfg/cfg.hpp"
+#include "io/sink.hpp"
 
 namespace cfg {
 
@@ -13,6 +14,12 @@ class RandomAccess
 
         virtual void rankSelect(uint64_t i, int& rank, uint64_t& select) = 0;
 
+        /**
+          * Decodes a substring to an output with a put(char) method.
+          */
+        template <class Output>
+        void decode(Output& out, uint64_t begin, uint64_t end);
+
     protected:
 
         CFG* cfg;
@@ -30,6 +37,17 @@ class RandomAccess
           * @throws Exception if begin or end is out of bounds.
           */
         void get(std::ostream& out, uint64_t begin, uint64_t end);
+
+        /**
+          * Gets a substring in the original string without going through a stream for each
+          * character. The sink isn't flushed.
+          *
+          * @param out The sink to write the substring to.
+          * @param begin The start position of the substring in the original string.
+          * @param end The end position of the substring in the original string.
+          * @throws Exception if begin or end is out of bounds.
+          */
+        void get(io::Sink& out, uint64_t begin, uint64_t end);
 };
 
 }
@@ -1,35 +1,68 @@
 #ifndef INCLUDED_CFG_RANDOM_ACCESS_AMT
 #define INCLUDED_CFG_RANDOM_ACCESS_AMT
 
+#include <string>
 #include "amt/compressed_sum_set.hpp"
+#include "amt/key.hpp"
 #include "cfg/random_access.hpp"
 
 namespace cfg {
 
-/** Indexes a CFG for random access using a tail-compressed array mapped trie with partial sums. */
+/**
+ * Indexes a CFG for random access using a tail-compressed array mapped trie with partial sums. The
+ * phrase start positions are 6 digit keys if they fit, otherwise they're 11 digit keys so texts may
+ * be longer than 64GiB. The shorter keys keep the trie shallower.
+ *
+ * The trie can be saved to a file the first time it's built, and later indexes of the grammar map
+ * the file instead of building the trie again, so they're ready at once and share its pages.
+ **/
 class RandomAccessAMT : public RandomAccess
 {
 
 private:
 
-    static const int KEY_LENGTH = 6;
+    // only one is used
+    amt::CompressedSumSet<amt::Key6>* cset6;
+    amt::CompressedSumSet<amt::Key11>* cset11;
 
-    amt::CompressedSumSet* cset;
-
-    void setValues(amt::Set& set);
+    template <class Key>
+    amt::CompressedSumSet<Key>* construct(std::string filename);
 
+    uint64_t fingerprint(uint64_t* ruleSizes);
     uint64_t ruleSize(uint64_t* ruleSizes, int rule);
 
+    template <class Key>
+    void rankSelect(amt::CompressedSumSet<Key>* cset, uint64_t i, int& rank, uint64_t& select);
+
     void rankSelect(uint64_t i, int& rank, uint64_t& select);
 
 public:
 
-    static uint64_t getKey(uint8_t* key);
-    static void setKey(uint8_t* key, uint64_t value);
-
-    RandomAccessAMT(CFG* cfg);
+    /**
+      * @param cfg The grammar to index.
+      * @param filename The file the grammar's trie is loaded from if it exists, or saved to once
+      *                 it's built otherwise, or empty to always build the trie without saving it.
+      * @throws Exception if the file isn't a saved trie of this grammar, or the trie can't be
+      *                   saved.
+      */
+    RandomAccessAMT(CFG* cfg, std::string filename = "");
     ~RandomAccessAMT();
 
+    /** @return The number of bytes used by the trie. */
+    uint64_t memSize();
+
+    /**
+      * Gets the rank and select of each of a batch of text positions with one batched predecessor
+      * query, which is faster than querying them one at a time.
+      *
+      * @param positions The text positions to query.
+      * @param ranks The array to store the number of start positions in [0, i] for each position i.
+      * @param selects The array to store the largest start position that is less than or equal to
+      *                each position in.
+      * @param n The number of positions.
+      */
+    void rankSelectBatch(const uint64_t* positions, uint64_t* ranks, uint64_t* selects, uint64_t n);
+
 };
 
 }
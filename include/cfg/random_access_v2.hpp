@@ -4,6 +4,7 @@
 #include <ostream>
 #include <stack>
 #include "cfg/cfg.hpp"
+#include "io/sink.hpp"
 
 namespace cfg {
 
@@ -17,6 +18,12 @@ class RandomAccessV2
         virtual void rankSelect(uint64_t i, int& rank, uint64_t& select) = 0;
         virtual uint64_t expansionSize(int rule) = 0;
 
+        /**
+          * Decodes a substring to an output with a put(char) method.
+          */
+        template <class Output>
+        void decode(Output& out, uint64_t begin, uint64_t end);
+
     protected:
 
         CFG* cfg;
@@ -35,6 +42,16 @@ class RandomAccessV2
           */
         //void get(std::ostream& out, uint64_t begin, uint64_t end);
         void get(char* out, uint64_t begin, uint64_t end);
+
+        /**
+          * Gets a substring in the original string. The substring is streamed to the sink, so it
+          * may be longer than any buffer, but the sink isn't flushed.
+          *
+          * @param out The sink to write the substring to.
+          * @param begin The start position of the substring in the original string.
+          * @param end The end position (exclusive) of the substring in the original string.
+          */
+        void get(io::Sink& out, uint64_t begin, uint64_t end);
 };
 
 }
@@ -0,0 +1,176 @@
+#ifndef INCLUDED_CFG_RANDOM_ACCESS_V2_CACHE
+#define INCLUDED_CFG_RANDOM_ACCESS_V2_CACHE
+
+#include <algorithm>
+#include <cstring>  // memcpy
+#include "cfg/random_access_v2_sd.hpp"
+
+namespace cfg {
+
+/**
+ * Indexes a CFG for random access like RandomAccessV2SD and caches the first and last k characters
+ * of each rule's expansion. A query of at most 2k characters descends the parse tree to the lowest
+ * rule whose expansion covers it and is then copied from the cached fragments of the characters it
+ * spans, typically the suffix of one character and the prefix of the next. Queries that can't be
+ * answered from the caches fall back to decoding the rules.
+ * NOTE: this class requires that the CFG rules are in smallest-expansion-first order.
+ **/
+template <class start_index = StartIndexSD>
+class RandomAccessV2Cache : public RandomAccessV2SD<start_index>
+{
+
+private:
+
+    typedef RandomAccessV2SD<start_index> Base;
+
+    uint64_t k;
+
+    // the first and last min(k, expansion length) characters of rule i are stored at
+    // (i - ALPHABET_SIZE) * k
+    char* prefixes;
+    char* suffixes;
+
+    void initializeCaches()
+    {
+        uint64_t numRules = this->cfg->numRules;
+        prefixes = new char[numRules * k];
+        suffixes = new char[numRules * k];
+
+        // copy the parts of each character that overlap the rule's first and last k characters
+        int current = -1;
+        uint64_t position = 0, size = 0, cached = 0;
+        Base::annotateRules([&](int rule, int c) {
+            if (rule != current) {
+                current = rule;
+                position = 0;
+                size = Base::characterSize(rule);
+                cached = std::min(k, size);
+            }
+            uint64_t length = Base::characterSize(c);
+            uint64_t end = position + length;
+            if (position < cached) {
+                copyFragment(c, 0, std::min(end, cached) - position, prefixes + (rule - CFG::ALPHABET_SIZE) * k + position);
+            }
+            uint64_t begin = std::max(position, size - cached);
+            if (begin < end) {
+                copyFragment(c, begin - position, end - begin, suffixes + (rule - CFG::ALPHABET_SIZE) * k + begin - (size - cached));
+            }
+            position = end;
+        });
+    }
+
+    /**
+      * Copies part of a character's expansion from the caches.
+      *
+      * @param c The character.
+      * @param offset The offset of the part in the character's expansion.
+      * @param length The length of the part.
+      * @param out The array to copy the part to.
+      * @return False if the part isn't cached.
+      */
+    bool copyFragment(int c, uint64_t offset, uint64_t length, char* out)
+    {
+        if (c < CFG::ALPHABET_SIZE) {
+            out[0] = (char) c;
+            return true;
+        }
+        uint64_t size = Base::characterSize(c);
+        uint64_t cached = std::min(k, size);
+        const char* prefix = prefixes + (c - CFG::ALPHABET_SIZE) * k;
+        const char* suffix = suffixes + (c - CFG::ALPHABET_SIZE) * k;
+        // in the prefix
+        if (offset + length <= cached) {
+            std::memcpy(out, prefix + offset, length);
+            return true;
+        }
+        // in the suffix
+        if (offset >= size - cached) {
+            std::memcpy(out, suffix + offset - (size - cached), length);
+            return true;
+        }
+        // the prefix and suffix overlap so they cover the whole expansion
+        if (size <= 2 * k) {
+            std::memcpy(out, prefix + offset, k - offset);
+            std::memcpy(out + k - offset, suffix + k - (size - k), length - (k - offset));
+            return true;
+        }
+        return false;
+    }
+
+public:
+
+    /**
+      * @param cfg The grammar to index.
+      * @param k The number of characters to cache at each end of each rule.
+      */
+    RandomAccessV2Cache(CFG* cfg, uint64_t k): Base(cfg), k(k)
+    {
+        initializeCaches();
+    }
+
+    ~RandomAccessV2Cache()
+    {
+        delete[] prefixes;
+        delete[] suffixes;
+    }
+
+    uint64_t memSize()
+    {
+        return Base::memSize() + cacheMemSize();
+    }
+
+    uint64_t cacheMemSize()
+    {
+        return 2 * sizeof(char) * this->cfg->numRules * k;
+    }
+
+    /**
+      * Gets a substring in the original string.
+      *
+      * @param out The array to write the substring to.
+      * @param begin The start position of the substring in the original string.
+      * @param end The end position of the substring in the original string.
+      */
+    void get(char* out, uint64_t begin, uint64_t end)
+    {
+        uint64_t length = end - begin;
+        if (length > 2 * k) {
+            RandomAccessV2::get(out, begin, end);
+            return;
+        }
+
+        // get the start rule character to start parsing at
+        int rank;
+        uint64_t selected;
+        Base::rankSelect(begin, rank, selected);
+        int rule = this->cfg->startRule, i = rank - 1;
+        uint64_t offset = begin - selected;
+
+        // descend to the lowest rule that covers the substring
+        int c;
+        uint64_t size;
+        while ((c = this->cfg->rules[rule][i]) >= CFG::ALPHABET_SIZE && offset + length <= Base::characterSize(c)) {
+            rule = c;
+            for (i = 0; offset >= (size = Base::characterSize(this->cfg->rules[rule][i])); i++) {
+                offset -= size;
+            }
+        }
+
+        // copy the fragments of the characters the substring spans
+        uint64_t take;
+        for (uint64_t j = 0; j < length; i++) {
+            c = this->cfg->rules[rule][i];
+            take = std::min(length - j, Base::characterSize(c) - offset);
+            if (!copyFragment(c, offset, take, out + j)) {
+                RandomAccessV2::get(out, begin, end);
+                return;
+            }
+            j += take;
+            offset = 0;
+        }
+    }
+};
+
+}
+
+#endif
@@ -0,0 +1,107 @@
+#ifndef INCLUDED_CFG_RANDOM_ACCESS_V2_CODED
+#define INCLUDED_CFG_RANDOM_ACCESS_V2_CODED
+
+#include <vector>
+#include "cfg/random_access_v2_sd.hpp"
+#include "cfg/rules_codec.hpp"
+
+namespace cfg {
+
+/**
+ * Indexes a CFG for random access like RandomAccessV2SD but decodes the rules from a compact
+ * encoding instead of the CFG's int arrays. The rules_codec policy stores the rules; see
+ * RulesPacked for the interface it must provide.
+ * NOTE: this class requires that the CFG rules are in smallest-expansion-first order.
+ **/
+template <class rules_codec, class start_index = StartIndexSD>
+class RandomAccessV2Coded : public RandomAccessV2SD<start_index>
+{
+
+private:
+
+    typedef RandomAccessV2SD<start_index> Base;
+    typedef typename rules_codec::Cursor Cursor;
+
+    rules_codec rules;
+
+    std::vector<Cursor> cursorStack;
+
+public:
+
+    RandomAccessV2Coded(CFG* cfg): Base(cfg), rules(cfg)
+    {
+        cursorStack.reserve(cfg->depth + 1);
+    }
+
+    /** The size of the index and the encoded rules, which replace the CFG's rules. */
+    uint64_t memSize()
+    {
+        return Base::memSize() + rules.memSize();
+    }
+
+    uint64_t rulesMemSize()
+    {
+        return rules.memSize();
+    }
+
+    /**
+      * Gets a substring in the original string.
+      *
+      * @param out The array to write the substring to.
+      * @param begin The start position of the substring in the original string.
+      * @param end The end position of the substring in the original string.
+      */
+    void get(char* out, uint64_t begin, uint64_t end)
+    {
+        uint64_t length = end - begin;
+        cursorStack.clear();
+
+        // get the start rule character to start parsing at
+        int rank;
+        uint64_t selected;
+        Base::rankSelect(begin, rank, selected);
+        Cursor cursor;
+        rules.open(this->cfg->startRule, rank - 1, cursor);
+
+        // descend the parse tree to the correct start position
+        uint64_t size, ignore = begin - selected;
+        int c;
+        while (ignore > 0) {
+            c = rules.next(cursor);
+            // terminal character
+            if (c < CFG::ALPHABET_SIZE) {
+                ignore--;
+            // non-terminal character
+            } else {
+                size = Base::expansionSize(c);
+                if (size > ignore) {
+                    cursorStack.push_back(cursor);
+                    rules.open(c, 0, cursor);
+                } else {
+                    ignore -= size;
+                }
+            }
+        }
+
+        // decode the substring
+        for (uint64_t j = 0; j < length;) {
+            c = rules.next(cursor);
+            // end of rule
+            if (c == CFG::DUMMY_CODE) {
+                cursor = cursorStack.back();
+                cursorStack.pop_back();
+            // terminal character
+            } else if (c < CFG::ALPHABET_SIZE) {
+                out[j++] = (char) c;
+            // non-terminal character
+            } else {
+                cursorStack.push_back(cursor);
+                rules.open(c, 0, cursor);
+            }
+        }
+    }
+};
+
+}
+
+#endif
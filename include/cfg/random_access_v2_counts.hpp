@@ -0,0 +1,189 @@
+#ifndef INCLUDED_CFG_RANDOM_ACCESS_V2_COUNTS
+#define INCLUDED_CFG_RANDOM_ACCESS_V2_COUNTS
+
+#include <algorithm>
+#include <bit>
+#include <stdexcept>
+#include <string>
+#include <sdsl/int_vector.hpp>
+#include "cfg/random_access_v2_sd.hpp"
+
+namespace cfg {
+
+/**
+ * Indexes a CFG for random access like RandomAccessV2SD and annotates each rule with the number of
+ * times each of a chosen subset of symbols occurs in its expansion. The counts are bit-packed with
+ * the fewest bits needed for the largest rule. Counting symbols in a range then only descends the
+ * parse tree at the range's two boundaries instead of decoding the range.
+ * NOTE: this class requires that the CFG rules are in smallest-expansion-first order.
+ **/
+template <class start_index = StartIndexSD>
+class RandomAccessV2Counts : public RandomAccessV2SD<start_index>
+{
+
+private:
+
+    typedef RandomAccessV2SD<start_index> Base;
+
+    std::string symbols;
+    int numSymbols;
+    // the index of each byte in symbols or -1 if it isn't counted
+    int symbolIndexes[CFG::ALPHABET_SIZE];
+
+    // the counts of rule i are stored at [(i - ALPHABET_SIZE) * numSymbols, (i - ALPHABET_SIZE + 1) * numSymbols)
+    sdsl::int_vector<> ruleCounts;
+
+    // the counts in the first i characters of the start rule are stored at [i * numSymbols, (i + 1) * numSymbols)
+    sdsl::int_vector<> startCounts;
+
+    // the counts before a histogram's range
+    uint64_t* beginCounts;
+
+    void initializeCounts()
+    {
+        int startRule = this->cfg->startRule;
+        int startSize = this->cfg->startSize;
+
+        // the largest count is at most the longest expansion of a rule
+        uint64_t maxSize = (startRule > CFG::ALPHABET_SIZE) ? Base::expansionSize(startRule - 1) : 1;
+        ruleCounts = sdsl::int_vector<>((uint64_t) this->cfg->numRules * numSymbols, 0, 64 - std::countl_zero(maxSize));
+        startCounts = sdsl::int_vector<>((uint64_t) (startSize + 1) * numSymbols, 0, 64 - std::countl_zero(this->cfg->textLength | 1));
+
+        Base::annotateRules([this](int rule, int c) {
+            uint64_t offset = (uint64_t) (rule - CFG::ALPHABET_SIZE) * numSymbols;
+            for (int s = 0; s < numSymbols; s++) {
+                ruleCounts[offset + s] = ruleCounts[offset + s] + characterCount(c, s);
+            }
+        });
+
+        uint64_t* counts = new uint64_t[numSymbols];
+        std::fill(counts, counts + numSymbols, 0);
+        for (int i = 0; i < startSize; i++) {
+            addCounts(this->cfg->rules[startRule][i], counts);
+            for (int s = 0; s < numSymbols; s++) {
+                startCounts[(uint64_t) (i + 1) * numSymbols + s] = counts[s];
+            }
+        }
+        delete[] counts;
+    }
+
+    uint64_t characterCount(int c, int s)
+    {
+        if (c < CFG::ALPHABET_SIZE) {
+            return symbolIndexes[c] == s;
+        }
+        return ruleCounts[(uint64_t) (c - CFG::ALPHABET_SIZE) * numSymbols + s];
+    }
+
+    void addCounts(int c, uint64_t* counts)
+    {
+        if (c < CFG::ALPHABET_SIZE) {
+            if (symbolIndexes[c] != -1) counts[symbolIndexes[c]]++;
+            return;
+        }
+        uint64_t offset = (uint64_t) (c - CFG::ALPHABET_SIZE) * numSymbols;
+        for (int s = 0; s < numSymbols; s++) {
+            counts[s] += ruleCounts[offset + s];
+        }
+    }
+
+    void addStartCounts(int r, uint64_t* counts)
+    {
+        uint64_t offset = (uint64_t) r * numSymbols;
+        for (int s = 0; s < numSymbols; s++) {
+            counts[s] += startCounts[offset + s];
+        }
+    }
+
+    uint64_t prefixCount(uint64_t i, int s)
+    {
+        uint64_t count;
+        Base::visitPrefix(i,
+            [this, s, &count](int r) { count = startCounts[(uint64_t) r * numSymbols + s]; },
+            [this, s, &count](int c) { count += characterCount(c, s); });
+        return count;
+    }
+
+public:
+
+    /**
+      * @param cfg The grammar to index.
+      * @param symbols The bytes to count.
+      * @throws Exception if a byte occurs more than once in symbols.
+      */
+    RandomAccessV2Counts(CFG* cfg, std::string symbols): Base(cfg), symbols(symbols)
+    {
+        numSymbols = symbols.size();
+        std::fill(symbolIndexes, symbolIndexes + CFG::ALPHABET_SIZE, -1);
+        for (int s = 0; s < numSymbols; s++) {
+            unsigned char c = symbols[s];
+            if (symbolIndexes[c] != -1) {
+                throw std::runtime_error("duplicate symbol to count");
+            }
+            symbolIndexes[c] = s;
+        }
+        initializeCounts();
+        beginCounts = new uint64_t[numSymbols];
+    }
+
+    ~RandomAccessV2Counts()
+    {
+        delete[] beginCounts;
+    }
+
+    uint64_t memSize()
+    {
+        return Base::memSize() + sdsl::size_in_bytes(ruleCounts) + sdsl::size_in_bytes(startCounts);
+    }
+
+    uint64_t countsMemSize()
+    {
+        return sdsl::size_in_bytes(ruleCounts) + sdsl::size_in_bytes(startCounts);
+    }
+
+    /**
+      * Counts the occurrences of a symbol in a substring of the original string.
+      *
+      * @param c The symbol to count.
+      * @param begin The start position of the substring in the original string.
+      * @param end The end position (exclusive) of the substring in the original string.
+      * @return The number of occurrences of c in the substring.
+      * @throws Exception if c is not one of the symbols that are counted.
+      */
+    uint64_t count(char c, uint64_t begin, uint64_t end)
+    {
+        int s = symbolIndexes[(unsigned char) c];
+        if (s == -1) {
+            throw std::runtime_error("symbol is not counted");
+        }
+        return prefixCount(end, s) - prefixCount(begin, s);
+    }
+
+    /**
+      * Counts the occurrences of every counted symbol in a substring of the original string.
+      *
+      * @param begin The start position of the substring in the original string.
+      * @param end The end position (exclusive) of the substring in the original string.
+      * @param counts The count of each symbol is written here, in the order the symbols were given.
+      */
+    void histogram(uint64_t begin, uint64_t end, uint64_t* counts)
+    {
+        std::fill(counts, counts + numSymbols, 0);
+        Base::visitPrefix(end,
+            [this, counts](int r) { addStartCounts(r, counts); },
+            [this, counts](int c) { addCounts(c, counts); });
+
+        // subtract the counts before the substring
+        std::fill(beginCounts, beginCounts + numSymbols, 0);
+        Base::visitPrefix(begin,
+            [this](int r) { addStartCounts(r, beginCounts); },
+            [this](int c) { addCounts(c, beginCounts); });
+        for (int s = 0; s < numSymbols; s++) {
+            counts[s] -= beginCounts[s];
+        }
+    }
+};
+
+}
+
+#endif
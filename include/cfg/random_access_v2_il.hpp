@@ -0,0 +1,66 @@
+#ifndef INCLUDED_CFG_RANDOM_ACCESS_V2_IL
+#define INCLUDED_CFG_RANDOM_ACCESS_V2_IL
+
+#include <vector>
+#include "cfg/cfg.hpp"
+#include "cfg/start_index_sd.hpp"
+
+namespace cfg {
+
+/**
+ * Indexes a CFG for random access using interleaved rule records. Every symbol of a rule is stored
+ * as a 64 bit record that holds a reference to the child's records in the low 32 bits and the
+ * child's expansion length in the high 32 bits, so the descent only touches the records of the
+ * rule being parsed. Lengths of 2^31 or more are stored in a side array that the high bits index.
+ * NOTE: this class requires that the CFG rules are in smallest-expansion-first order.
+ **/
+class RandomAccessV2IL
+{
+
+private:
+
+    // records with this reference mark the end of a rule
+    static const uint32_t END_OF_RULE = UINT32_MAX;
+
+    // records with at least this length store largeExpansions index + LARGE_EXPANSION instead
+    static const uint32_t LARGE_EXPANSION = ((uint32_t) 1) << 31;
+
+    CFG* cfg;
+
+    std::vector<uint32_t> recordStack;
+
+    // references < CFG::ALPHABET_SIZE are terminal characters; all other references are offsets
+    // into the records array shifted by CFG::ALPHABET_SIZE
+    uint64_t* records;
+    uint64_t numRecords;
+    uint32_t startRecord;
+
+    // the expansion lengths of the rules from firstLargeRule on, which don't fit in a record
+    std::vector<uint64_t> largeExpansions;
+
+    StartIndexSD* startIndex;
+
+    void initializeRecords();
+
+    uint64_t recordSize(uint64_t record);
+
+public:
+
+    uint64_t memSize();
+
+    RandomAccessV2IL(CFG* cfg);
+    ~RandomAccessV2IL();
+
+    /**
+      * Gets a substring in the original string.
+      *
+      * @param out The output array to write the substring to.
+      * @param begin The start position of the substring in the original string.
+      * @param end The end position of the substring in the original string.
+      */
+    void get(char* out, uint64_t begin, uint64_t end);
+};
+
+}
+
+#endif
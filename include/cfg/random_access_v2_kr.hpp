@@ -0,0 +1,205 @@
+#ifndef INCLUDED_CFG_RANDOM_ACCESS_V2_KR
+#define INCLUDED_CFG_RANDOM_ACCESS_V2_KR
+
+#include <algorithm>
+#include <random>
+#include "cfg/random_access_v2_sd.hpp"
+
+namespace cfg {
+
+/**
+ * Indexes a CFG for random access like RandomAccessV2SD and stores the Karp-Rabin fingerprint of
+ * each rule's expansion alongside its expansion length. The fingerprint of any substring can then
+ * be computed by descending the parse tree at its two ends, which enables substring equality and
+ * longest common extension queries without extracting any text.
+ *
+ * Fingerprints are computed modulo the Mersenne prime 2^61 - 1 with a base chosen at random, so two
+ * different substrings of length l have the same fingerprint with probability at most l / 2^61.
+ * NOTE: this class requires that the CFG rules are in smallest-expansion-first order.
+ **/
+template <class start_index = StartIndexSD>
+class RandomAccessV2KR : public RandomAccessV2SD<start_index>
+{
+
+private:
+
+    typedef RandomAccessV2SD<start_index> Base;
+
+    static const uint64_t PRIME = (((uint64_t) 1) << 61) - 1;
+
+    uint64_t base;
+
+    // the fingerprint of each rule's expansion and base^(expansion length)
+    uint64_t* fingerprints;
+    uint64_t* powers;
+
+    // the fingerprints of the prefixes of the start rule; startPrefixes[i] covers its first i characters
+    uint64_t* startPrefixes;
+
+    static uint64_t mulMod(uint64_t a, uint64_t b)
+    {
+        __uint128_t product = (__uint128_t) a * b;
+        uint64_t result = (uint64_t) (product & PRIME) + (uint64_t) (product >> 61);
+        return (result >= PRIME) ? result - PRIME : result;
+    }
+
+    static uint64_t addMod(uint64_t a, uint64_t b)
+    {
+        uint64_t result = a + b;
+        return (result >= PRIME) ? result - PRIME : result;
+    }
+
+    uint64_t powMod(uint64_t exponent)
+    {
+        uint64_t result = 1, power = base;
+        for (; exponent > 0; exponent >>= 1) {
+            if (exponent & 1) result = mulMod(result, power);
+            power = mulMod(power, power);
+        }
+        return result;
+    }
+
+    void initializeFingerprints()
+    {
+        fingerprints = new uint64_t[this->cfg->startRule];
+        powers = new uint64_t[this->cfg->startRule];
+        for (int i = 0; i < CFG::ALPHABET_SIZE; i++) {
+            fingerprints[i] = i + 1;  // +1 so strings of 0 bytes have non-zero fingerprints
+            powers[i] = base;
+        }
+        std::fill(fingerprints + CFG::ALPHABET_SIZE, fingerprints + this->cfg->startRule, 0);
+        std::fill(powers + CFG::ALPHABET_SIZE, powers + this->cfg->startRule, 1);
+
+        Base::annotateRules([this](int rule, int c) {
+            fingerprints[rule] = addMod(mulMod(fingerprints[rule], powers[c]), fingerprints[c]);
+            powers[rule] = mulMod(powers[rule], powers[c]);
+        });
+
+        int c;
+        startPrefixes = new uint64_t[this->cfg->startSize + 1];
+        startPrefixes[0] = 0;
+        for (int i = 0; i < this->cfg->startSize; i++) {
+            c = this->cfg->rules[this->cfg->startRule][i];
+            startPrefixes[i + 1] = addMod(mulMod(startPrefixes[i], powers[c]), fingerprints[c]);
+        }
+    }
+
+    /**
+      * Computes the fingerprint of the text prefix that ends before position i.
+      *
+      * @param i The end position (exclusive) of the prefix.
+      * @return The fingerprint of the prefix [0, i).
+      */
+    uint64_t prefixFingerprint(uint64_t i)
+    {
+        uint64_t fingerprint;
+        Base::visitPrefix(i,
+            [this, &fingerprint](int r) { fingerprint = startPrefixes[r]; },
+            [this, &fingerprint](int c) { fingerprint = addMod(mulMod(fingerprint, powers[c]), fingerprints[c]); });
+        return fingerprint;
+    }
+
+    bool prefixesEqual(uint64_t i, uint64_t iPrefix, uint64_t j, uint64_t jPrefix, uint64_t length, uint64_t power)
+    {
+        uint64_t a = addMod(prefixFingerprint(i + length), PRIME - mulMod(iPrefix, power));
+        uint64_t b = addMod(prefixFingerprint(j + length), PRIME - mulMod(jPrefix, power));
+        return a == b;
+    }
+
+public:
+
+    /**
+      * @param cfg The grammar to index.
+      * @param seed The seed used to choose the fingerprints' base.
+      */
+    RandomAccessV2KR(CFG* cfg, uint64_t seed): Base(cfg)
+    {
+        std::mt19937_64 eng(seed);
+        base = std::uniform_int_distribution<uint64_t>(CFG::ALPHABET_SIZE + 1, PRIME - 1)(eng);
+        initializeFingerprints();
+    }
+
+    ~RandomAccessV2KR()
+    {
+        delete[] fingerprints;
+        delete[] powers;
+        delete[] startPrefixes;
+    }
+
+    uint64_t memSize()
+    {
+        uint64_t fingerprintsSize = 2 * sizeof(uint64_t) * this->cfg->startRule;
+        uint64_t startPrefixesSize = sizeof(uint64_t) * (this->cfg->startSize + 1);
+        return Base::memSize() + fingerprintsSize + startPrefixesSize;
+    }
+
+    /**
+      * Computes the Karp-Rabin fingerprint of a substring in the original string.
+      *
+      * @param begin The start position of the substring in the original string.
+      * @param end The end position (exclusive) of the substring in the original string.
+      * @return The fingerprint of the substring.
+      */
+    uint64_t fingerprint(uint64_t begin, uint64_t end)
+    {
+        uint64_t power = powMod(end - begin);
+        return addMod(prefixFingerprint(end), PRIME - mulMod(prefixFingerprint(begin), power));
+    }
+
+    /**
+      * Checks if two substrings of the original string are equal by comparing their fingerprints.
+      *
+      * @param i The start position of the first substring.
+      * @param j The start position of the second substring.
+      * @param length The length of the substrings.
+      * @return True if the substrings are equal (with high probability).
+      */
+    bool equal(uint64_t i, uint64_t j, uint64_t length)
+    {
+        if (i == j || length == 0) return true;
+        return fingerprint(i, i + length) == fingerprint(j, j + length);
+    }
+
+    /**
+      * Computes the longest common extension of two suffixes of the original string, i.e. the
+      * length of their longest common prefix, with an exponential search followed by a binary
+      * search.
+      *
+      * @param i The start position of the first suffix.
+      * @param j The start position of the second suffix.
+      * @return The length of the longest common prefix of the suffixes (with high probability).
+      */
+    uint64_t lce(uint64_t i, uint64_t j)
+    {
+        uint64_t maxLength = this->cfg->textLength - std::max(i, j);
+        if (i == j) return maxLength;
+        uint64_t iPrefix = prefixFingerprint(i);
+        uint64_t jPrefix = prefixFingerprint(j);
+
+        // double the length until the extensions differ
+        uint64_t lo = 0, hi = 1, power = base;
+        while (hi <= maxLength && prefixesEqual(i, iPrefix, j, jPrefix, hi, power)) {
+            lo = hi;
+            hi *= 2;
+            power = mulMod(power, power);
+        }
+        hi = std::min(hi, maxLength + 1);
+
+        // the extensions are equal for lo characters and differ for hi characters
+        uint64_t mid;
+        while (hi - lo > 1) {
+            mid = lo + (hi - lo) / 2;
+            if (prefixesEqual(i, iPrefix, j, jPrefix, mid, powMod(mid))) {
+                lo = mid;
+            } else {
+                hi = mid;
+            }
+        }
+
+        return lo;
+    }
+};
+
+}
+
+#endif
@@ -0,0 +1,218 @@
+#ifndef INCLUDED_CFG_RANDOM_ACCESS_V2_LINES
+#define INCLUDED_CFG_RANDOM_ACCESS_V2_LINES
+
+#include <algorithm>
+#include <bit>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#include <sdsl/int_vector.hpp>
+#include <sdsl/util.hpp>
+#include "cfg/random_access_v2_sd.hpp"
+
+namespace cfg {
+
+/**
+ * Indexes a CFG for random access like RandomAccessV2SD and annotates each rule with the number of
+ * newlines in its expansion so that newline-delimited records can be accessed by line number. A
+ * line is found by descending the parse tree by newline count, the same way random access descends
+ * by expansion length. Lines are numbered from 0 and line k begins after the k-th newline.
+ * NOTE: this class requires that the CFG rules are in smallest-expansion-first order.
+ **/
+template <class start_index = StartIndexSD>
+class RandomAccessV2Lines : public RandomAccessV2SD<start_index>
+{
+
+private:
+
+    typedef RandomAccessV2SD<start_index> Base;
+
+    static const int NEWLINE = '\n';
+
+    sdsl::int_vector<> ruleNewlines;
+
+    // the number of newlines in the first i characters of the start rule and the text position of
+    // the i-th character
+    sdsl::int_vector<> startNewlines;
+    sdsl::int_vector<> startPositions;
+
+    // the (rule, index of the next character) frames of a line's descent
+    std::vector<std::pair<int, int>> frameStack;
+
+    void initializeNewlines()
+    {
+        int startRule = this->cfg->startRule;
+        int startSize = this->cfg->startSize;
+
+        // a rule can't have more newlines than the longest expansion
+        uint64_t maxSize = (startRule > CFG::ALPHABET_SIZE) ? Base::expansionSize(startRule - 1) : 1;
+        ruleNewlines = sdsl::int_vector<>(this->cfg->numRules, 0, 64 - std::countl_zero(maxSize));
+
+        Base::annotateRules([this](int rule, int c) {
+            uint64_t i = rule - CFG::ALPHABET_SIZE;
+            ruleNewlines[i] = ruleNewlines[i] + characterNewlines(c);
+        });
+
+        int width = 64 - std::countl_zero(this->cfg->textLength | 1);
+        startNewlines = sdsl::int_vector<>(startSize + 1, 0, width);
+        startPositions = sdsl::int_vector<>(startSize + 1, 0, width);
+        uint64_t position = 0, count = 0;
+        int c;
+        for (int i = 0; i < startSize; i++) {
+            c = this->cfg->rules[startRule][i];
+            count += characterNewlines(c);
+            position += Base::characterSize(c);
+            startNewlines[i + 1] = count;
+            startPositions[i + 1] = position;
+        }
+        sdsl::util::bit_compress(startNewlines);
+    }
+
+    uint64_t characterNewlines(int c)
+    {
+        return (c < CFG::ALPHABET_SIZE) ? (c == NEWLINE) : (uint64_t) ruleNewlines[c - CFG::ALPHABET_SIZE];
+    }
+
+    /**
+      * Descends the parse tree to the k-th newline, leaving the descent's frames on the stack.
+      *
+      * @param k The newline to descend to; must be in [1, numNewlines()].
+      * @return The text position of the newline.
+      */
+    uint64_t descendToNewline(uint64_t k)
+    {
+        frameStack.clear();
+
+        // binary search for the start rule character that contains the newline
+        uint64_t lo = 0, n = this->cfg->startSize;
+        while (n > 1) {
+            uint64_t half = n / 2;
+            lo = (startNewlines[lo + half] < k) ? lo + half : lo;
+            n -= half;
+        }
+        uint64_t remaining = k - startNewlines[lo];
+        uint64_t position = startPositions[lo];
+        int rule = this->cfg->rules[this->cfg->startRule][lo];
+        frameStack.push_back({this->cfg->startRule, (int) lo + 1});
+
+        // descend by newline count until the newline itself is reached
+        uint64_t count;
+        int c;
+        while (rule >= CFG::ALPHABET_SIZE) {
+            for (int j = 0; ; j++) {
+                c = this->cfg->rules[rule][j];
+                count = characterNewlines(c);
+                if (count >= remaining) {
+                    frameStack.push_back({rule, j + 1});
+                    rule = c;
+                    break;
+                }
+                remaining -= count;
+                position += Base::characterSize(c);
+            }
+        }
+
+        return position;
+    }
+
+public:
+
+    RandomAccessV2Lines(CFG* cfg): Base(cfg)
+    {
+        initializeNewlines();
+        frameStack.reserve(cfg->depth + 1);
+    }
+
+    uint64_t memSize()
+    {
+        return Base::memSize() + linesMemSize();
+    }
+
+    uint64_t linesMemSize()
+    {
+        return sdsl::size_in_bytes(ruleNewlines) + sdsl::size_in_bytes(startNewlines) + sdsl::size_in_bytes(startPositions);
+    }
+
+    uint64_t numNewlines()
+    {
+        return startNewlines[this->cfg->startSize];
+    }
+
+    /**
+      * Computes where a line begins in the original string.
+      *
+      * @param k The line number.
+      * @return The text position of the line's first character.
+      * @throws Exception if the text has fewer than k newlines.
+      */
+    uint64_t selectLine(uint64_t k)
+    {
+        if (k == 0) return 0;
+        if (k > numNewlines()) {
+            throw std::runtime_error("line is out of range");
+        }
+        return descendToNewline(k) + 1;
+    }
+
+    /**
+      * Computes which line contains a text position, i.e. the number of newlines before it.
+      *
+      * @param i The text position.
+      * @return The number of the line that contains i.
+      */
+    uint64_t lineOf(uint64_t i)
+    {
+        uint64_t count;
+        Base::visitPrefix(i,
+            [this, &count](int r) { count = startNewlines[r]; },
+            [this, &count](int c) { count += characterNewlines(c); });
+        return count;
+    }
+
+    /**
+      * Gets a line of the original string with a single descent of the parse tree.
+      *
+      * @param k The line number.
+      * @param line The line is written here, without its newline.
+      * @throws Exception if the text has fewer than k newlines.
+      */
+    void getLine(uint64_t k, std::string& line)
+    {
+        line.clear();
+        if (k > numNewlines()) {
+            throw std::runtime_error("line is out of range");
+        }
+        if (k == 0) {
+            frameStack.clear();
+            frameStack.push_back({this->cfg->startRule, 0});
+        } else {
+            descendToNewline(k);
+        }
+
+        // decode until the next newline or the end of the text
+        int c;
+        while (!frameStack.empty()) {
+            auto& [rule, j] = frameStack.back();
+            c = this->cfg->rules[rule][j];
+            // end of rule
+            if (c == CFG::DUMMY_CODE) {
+                frameStack.pop_back();
+                continue;
+            }
+            j++;
+            // terminal character
+            if (c < CFG::ALPHABET_SIZE) {
+                if (c == NEWLINE) break;
+                line.push_back((char) c);
+            // non-terminal character
+            } else {
+                frameStack.push_back({c, 0});
+            }
+        }
+    }
+};
+
+}
+
+#endif
@@ -2,6 +2,7 @@
 #define INCLUDED_CFG_RANDOM_ACCESS_V2_SD
 
 #include "cfg/random_access_v2.hpp"
+#include "cfg/start_index_sd.hpp"
 #include <sdsl/bit_vectors.hpp>
 #include <sdsl/util.hpp>
 
@@ -9,16 +10,17 @@ namespace cfg {
 
 /**
  * Indexes a CFG for random access using a bit vector.
+ * The start_index policy locates the start rule character that contains a text position; see
+ * StartIndexSD for the interface it must provide.
  * NOTE: this class requires that the CFG rules are in smallest-expansion-first order.
  **/
+template <class start_index = StartIndexSD>
 class RandomAccessV2SD : public RandomAccessV2
 {
 
 private:
 
-    sdsl::sd_vector<> startBitvector;
-    sdsl::sd_vector<>::rank_1_type startBitvectorRank;
-    sdsl::sd_vector<>::select_1_type startBitvectorSelect;
+    start_index* startIndex;
 
     sdsl::sd_vector<> expansionBitvector;
     sdsl::sd_vector<>::rank_1_type expansionBitvectorRank;
@@ -27,7 +29,6 @@ private:
 
     void initializeBitvectors()
     {
-        sdsl::bit_vector tmpStartBitvector(cfg->textLength, 0);
         // startRule = numRules + CFG::ALPHABET_SIZE
         sdsl::bit_vector tmpExpansionBitvector(cfg->startRule, 0);
 
@@ -40,15 +41,17 @@ private:
             ruleSizes[i] = 0;
         }
 
-        // set the start bitvector
+        // index the start positions
+        uint64_t* startPositions = new uint64_t[cfg->startSize];
         uint64_t pos = 0;
         int c;
         for (int i = 0; i < cfg->startSize; i++) {
             c = cfg->rules[cfg->startRule][i];
-            tmpStartBitvector[pos] = 1;
+            startPositions[i] = pos;
             pos += ruleSize(ruleSizes, c);
         }
-        startBitvector = sdsl::sd_vector<>(tmpStartBitvector);
+        startIndex = new start_index(startPositions, cfg->startSize, cfg->textLength);
+        delete[] startPositions;
 
         // set the expansion bitvector and count the number of unique expansions
         uint64_t previousSize = 1;
@@ -93,11 +96,11 @@ private:
         return ruleSizes[rule];
     }
 
+protected:
+
     void rankSelect(uint64_t i, int& rank, uint64_t& select)
     {
-        // i+1 because rank is exclusive [0, i) and we want inclusive [0, i]
-        rank = startBitvectorRank.rank(i + 1);
-        select = startBitvectorSelect.select(rank);
+        startIndex->predecessor(i, rank, select);
     }
 
     uint64_t expansionSize(int rule)
@@ -107,6 +110,68 @@ private:
         return expansionSizes[rank];
     }
 
+    /** @return The length of a character's expansion, which is 1 for a terminal. */
+    uint64_t characterSize(int c)
+    {
+        return (c < CFG::ALPHABET_SIZE) ? 1 : expansionSize(c);
+    }
+
+    /**
+      * Visits the characters of every rule in order to annotate the rules bottom-up. Rules are
+      * ordered by expansion length so a rule's characters are always annotated before it.
+      *
+      * @param visit A function called with each rule and each of its characters.
+      */
+    template <class Visit>
+    void annotateRules(Visit visit)
+    {
+        int c;
+        for (int i = CFG::ALPHABET_SIZE; i < cfg->startRule; i++) {
+            for (int j = 0; (c = cfg->rules[i][j]) != CFG::DUMMY_CODE; j++) {
+                visit(i, c);
+            }
+        }
+    }
+
+    /**
+      * Descends the parse tree to a text position and visits every character whose expansion
+      * ends at or before the position, after the start rule characters that precede it.
+      *
+      * @param i The end position (exclusive) of the prefix to visit.
+      * @param visitStart A function called first with the number of start rule characters that
+      *                   precede the visited characters, i.e. all of them if i is past the text.
+      * @param visit A function called with each character.
+      */
+    template <class VisitStart, class Visit>
+    void visitPrefix(uint64_t i, VisitStart visitStart, Visit visit)
+    {
+        if (i >= cfg->textLength) {
+            visitStart(cfg->startSize);
+            return;
+        }
+
+        // get the start rule character that contains i
+        int rank;
+        uint64_t selected;
+        rankSelect(i, rank, selected);
+        visitStart(rank - 1);
+
+        // descend the parse tree, visiting the characters that end at or before i
+        uint64_t size, remaining = i - selected;
+        int rule = cfg->rules[cfg->startRule][rank - 1];
+        int c;
+        while (remaining > 0) {
+            for (int j = 0; ; j++) {
+                c = cfg->rules[rule][j];
+                size = characterSize(c);
+                if (size > remaining) break;
+                visit(c);
+                remaining -= size;
+            }
+            rule = c;
+        }
+    }
+
 public:
 
     uint64_t memSize()
@@ -117,14 +182,12 @@ public:
         uint64_t numExpansions = expansionBitvectorRank.rank(expansionBitvector.size());
         uint64_t expansionSize = sizeof(uint64_t) * numExpansions;
 
-        uint64_t startBitvectorSize = sdsl::size_in_bytes(startBitvector);
-        uint64_t startBitvectorRankSize = sdsl::size_in_bytes(startBitvectorRank);
-        uint64_t startBitvectorSelectSize = sdsl::size_in_bytes(startBitvectorSelect);
+        uint64_t startIndexSize = startIndex->memSize();
 
         uint64_t expansionBitvectorSize = sdsl::size_in_bytes(expansionBitvector);
         uint64_t expansionBitvectorRankSize = sdsl::size_in_bytes(expansionBitvectorRank);
 
-        return startBitvectorSelectSize + startBitvectorRankSize + startBitvectorSelectSize +
+        return startIndexSize +
                expansionBitvectorSize + expansionBitvectorRankSize +
                expansionSize;
     }
@@ -132,13 +195,12 @@ public:
     RandomAccessV2SD(CFG* cfg): RandomAccessV2(cfg)
     {
         initializeBitvectors();
-        startBitvectorRank = sdsl::sd_vector<>::rank_1_type(&startBitvector);
-        startBitvectorSelect = sdsl::sd_vector<>::select_1_type(&startBitvector);
         expansionBitvectorRank = sdsl::sd_vector<>::rank_1_type(&expansionBitvector);
     }
 
     ~RandomAccessV2SD()
     {
+        delete startIndex;
         delete[] expansionSizes;
     };
 
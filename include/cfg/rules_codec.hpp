@@ -0,0 +1,178 @@
+#ifndef INCLUDED_CFG_RULES_CODEC
+#define INCLUDED_CFG_RULES_CODEC
+
+#include <cstdint>
+#include <cstring>  // memcpy
+#include <mutex>  // call_once
+#include <sdsl/int_vector.hpp>
+#include "cfg/cfg.hpp"
+
+#ifdef __SSSE3__
+#include <immintrin.h>
+#endif
+
+namespace cfg {
+
+/**
+ * Stores the rules and start rule of a CFG as one bit-packed sequence with ceil(log2(startRule+1))
+ * bits per character. Each rule is followed by an end of rule character. If every rule other than
+ * the start rule has the same length, as in RePair grammars, rule offsets are computed instead of
+ * stored.
+ *
+ * Characters are read through a Cursor: open() positions it in a rule and next() returns the
+ * character under it, or CFG::DUMMY_CODE at the end of the rule, and advances it.
+ **/
+class RulesPacked
+{
+
+private:
+
+    sdsl::int_vector<> characters;
+    uint8_t width;
+    // the start rule's character never occurs in a rule so it marks the end of rules
+    uint64_t endOfRule;
+
+    // used when the rules are not all the same length
+    sdsl::int_vector<> offsets;
+    // the length of each rule (+1 for the end of rule character) if they're all the same length
+    uint64_t ruleStride;
+    uint64_t startOffset;
+
+public:
+
+    typedef uint64_t Cursor;
+
+    RulesPacked(CFG* cfg);
+
+    uint64_t memSize();
+
+    void open(int rule, int i, Cursor& cursor)
+    {
+        uint64_t offset;
+        if (rule == (int) endOfRule) {
+            offset = startOffset;
+        } else if (ruleStride != 0) {
+            offset = (rule - CFG::ALPHABET_SIZE) * ruleStride;
+        } else {
+            offset = offsets[rule - CFG::ALPHABET_SIZE];
+        }
+        cursor = offset + i;
+    }
+
+    int next(Cursor& cursor)
+    {
+        uint64_t c = characters.get_int(cursor++ * width, width);
+        return (c == endOfRule) ? CFG::DUMMY_CODE : (int) c;
+    }
+};
+
+/**
+ * Stores the rules and start rule of a CFG as one StreamVByte encoded sequence: characters are
+ * grouped in fours, each group has a control byte with the byte length of its characters, and the
+ * characters are stored in the fewest whole bytes. Groups are decoded with a single shuffle when
+ * SSSE3 is available. The data offset of every BLOCK_SIZE-th group is sampled for random access.
+ *
+ * Characters are read through a Cursor: open() positions it in a rule and next() returns the
+ * character under it, or CFG::DUMMY_CODE at the end of the rule, and advances it.
+ **/
+class RulesVByte
+{
+
+private:
+
+    // the number of groups between data offset samples
+    static const int BLOCK_SIZE = 16;
+
+    // the byte length of a group for each control byte
+    static uint8_t groupLengths[256];
+#ifdef __SSSE3__
+    // the shuffle that spreads a group's bytes into four 32 bit lanes for each control byte
+    static uint8_t shuffles[256][16];
+#endif
+    // the tables are shared, so indexes built on different threads initialize them once
+    static std::once_flag tablesInitialized;
+    static void initializeTables();
+
+    uint8_t* control;
+    uint8_t* data;
+    uint64_t numGroups;
+    uint64_t dataSize;
+    sdsl::int_vector<> blockOffsets;
+    // the start rule's character never occurs in a rule so it marks the end of rules
+    uint32_t endOfRule;
+
+    // same as RulesPacked
+    sdsl::int_vector<> offsets;
+    uint64_t ruleStride;
+    uint64_t startOffset;
+
+    void decodeGroup(uint64_t group, uint64_t offset, uint32_t* values)
+    {
+#ifdef __SSSE3__
+        __m128i bytes = _mm_loadu_si128((const __m128i*) (data + offset));
+        __m128i shuffle = _mm_loadu_si128((const __m128i*) shuffles[control[group]]);
+        _mm_storeu_si128((__m128i*) values, _mm_shuffle_epi8(bytes, shuffle));
+#else
+        uint8_t key = control[group];
+        for (int lane = 0; lane < 4; lane++) {
+            int length = ((key >> (2 * lane)) & 0x3) + 1;
+            values[lane] = 0;
+            std::memcpy(&values[lane], data + offset, length);  // little endian
+            offset += length;
+        }
+#endif
+    }
+
+public:
+
+    struct Cursor
+    {
+        uint32_t values[4];
+        uint64_t group;
+        uint64_t offset;
+        int lane;
+    };
+
+    RulesVByte(CFG* cfg);
+    ~RulesVByte();
+
+    uint64_t memSize();
+
+    void open(int rule, int i, Cursor& cursor)
+    {
+        uint64_t position;
+        if (rule == (int) endOfRule) {
+            position = startOffset;
+        } else if (ruleStride != 0) {
+            position = (rule - CFG::ALPHABET_SIZE) * ruleStride;
+        } else {
+            position = offsets[rule - CFG::ALPHABET_SIZE];
+        }
+        position += i;
+
+        // sum the group lengths from the block's sampled offset to the cursor's group
+        cursor.group = position >> 2;
+        cursor.lane = position & 0x3;
+        uint64_t group = cursor.group - (cursor.group % BLOCK_SIZE);
+        cursor.offset = blockOffsets[cursor.group / BLOCK_SIZE];
+        for (; group < cursor.group; group++) {
+            cursor.offset += groupLengths[control[group]];
+        }
+        decodeGroup(cursor.group, cursor.offset, cursor.values);
+    }
+
+    int next(Cursor& cursor)
+    {
+        uint32_t c = cursor.values[cursor.lane++];
+        if (cursor.lane == 4) {
+            cursor.offset += groupLengths[control[cursor.group++]];
+            cursor.lane = 0;
+            decodeGroup(cursor.group, cursor.offset, cursor.values);
+        }
+        return (c == endOfRule) ? CFG::DUMMY_CODE : (int) c;
+    }
+};
+
+}
+
+#endif
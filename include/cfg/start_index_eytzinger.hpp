@@ -0,0 +1,146 @@
+#ifndef INCLUDED_CFG_START_INDEX_EYTZINGER
+#define INCLUDED_CFG_START_INDEX_EYTZINGER
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <new>  // align_val_t
+#include <sdsl/int_vector.hpp>
+#include <sdsl/util.hpp>
+
+namespace cfg {
+
+/**
+ * Indexes the text positions where the start rule's characters begin using a sorted array in
+ * Eytzinger (BFS) layout that is searched without branches. When sample_rate > 1 only every
+ * sample_rate-th position is stored in the Eytzinger array and the remaining positions are stored
+ * as bit-packed offsets from their sample, which bounds the memory used.
+ **/
+template <int sample_rate = 1>
+class StartIndexEytzinger
+{
+
+private:
+
+    // the number of Eytzinger nodes whose children are prefetched ahead of the search
+    static const int PREFETCH_DISTANCE = 16;
+
+    uint64_t size;
+    uint64_t numSamples;
+    int depth;
+
+    // 1-based Eytzinger array of samples; tree[0] is unused
+    uint64_t* tree;
+
+    // offsets of all positions from the sample of their block
+    sdsl::int_vector<> offsets;
+
+    uint64_t fill(const uint64_t* positions, uint64_t i, uint64_t k)
+    {
+        if (k <= numSamples) {
+            i = fill(positions, i, 2 * k);
+            tree[k] = positions[i * sample_rate];
+            i = fill(positions, i + 1, 2 * k + 1);
+        }
+        return i;
+    }
+
+    /**
+      * Converts the index the search ended at into the number of samples less than or equal to
+      * the query. The search ends at one of the numSamples + 1 external nodes of the tree; those on
+      * the deepest level precede the others in sorted order.
+      */
+    uint64_t gapRank(uint64_t k)
+    {
+        uint64_t deepest = ((uint64_t) 1) << (depth + 1);
+        if (k >= deepest) {
+            return k - deepest;
+        }
+        return 2 * (numSamples - (deepest >> 1) + 1) + (k - (numSamples + 1));
+    }
+
+public:
+
+    StartIndexEytzinger(const StartIndexEytzinger&) = delete;
+    StartIndexEytzinger& operator=(const StartIndexEytzinger&) = delete;
+
+    /**
+      * @param positions The sorted text positions where the start rule's characters begin.
+      * @param size The number of positions.
+      * @param textLength The length of the text.
+      */
+    StartIndexEytzinger(const uint64_t* positions, uint64_t size, uint64_t textLength): size(size)
+    {
+        numSamples = (size + sample_rate - 1) / sample_rate;
+        depth = 63 - std::countl_zero(numSamples);
+        tree = new (std::align_val_t(64)) uint64_t[numSamples + 1];
+        tree[0] = 0;
+        fill(positions, 0, 1);
+
+        if (sample_rate > 1) {
+            uint64_t maxOffset = 0, sample = 0;
+            for (uint64_t i = 0; i < size; i++) {
+                if (i % sample_rate == 0) sample = positions[i];
+                maxOffset = std::max(maxOffset, positions[i] - sample);
+            }
+            offsets = sdsl::int_vector<>(size, 0, 64 - std::countl_zero(maxOffset | 1));
+            for (uint64_t i = 0; i < size; i++) {
+                if (i % sample_rate == 0) sample = positions[i];
+                offsets[i] = positions[i] - sample;
+            }
+        }
+    }
+
+    ~StartIndexEytzinger()
+    {
+        operator delete[](tree, std::align_val_t(64));
+    }
+
+    uint64_t memSize()
+    {
+        return sizeof(uint64_t) * (numSamples + 1) + sdsl::size_in_bytes(offsets);
+    }
+
+    /**
+      * Selects the largest start position that is less than or equal to i and computes its rank.
+      *
+      * @param i The text position to query.
+      * @param rank The number of start positions in [0, i].
+      * @param select The largest start position that is less than or equal to i.
+      */
+    void predecessor(uint64_t i, int& rank, uint64_t& select)
+    {
+        // descend the tree; the last node that is <= i is the predecessor sample
+        uint64_t k = 1, value, sample = 0;
+        while (k <= numSamples) {
+            __builtin_prefetch(tree + k * PREFETCH_DISTANCE);
+            value = tree[k];
+            bool right = value <= i;
+            sample = right ? value : sample;
+            k = 2 * k + right;
+        }
+        uint64_t sampleRank = gapRank(k);
+
+        if (sample_rate == 1) {
+            rank = sampleRank;
+            select = sample;
+            return;
+        }
+
+        // binary search the sample's block for the last offset <= i - sample
+        uint64_t offset = i - sample;
+        uint64_t base = (sampleRank - 1) * sample_rate;
+        uint64_t n = std::min((uint64_t) sample_rate, size - base);
+        while (n > 1) {
+            uint64_t half = n / 2;
+            base = (offsets[base + half] <= offset) ? base + half : base;
+            n -= half;
+        }
+        rank = base + 1;
+        select = sample + offsets[base];
+    }
+};
+
+}
+
+#endif
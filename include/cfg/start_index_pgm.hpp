@@ -0,0 +1,148 @@
+#ifndef INCLUDED_CFG_START_INDEX_PGM
+#define INCLUDED_CFG_START_INDEX_PGM
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <limits>
+#include <vector>
+#include <sdsl/int_vector.hpp>
+#include <sdsl/util.hpp>
+
+namespace cfg {
+
+/**
+ * Indexes the text positions where the start rule's characters begin using a learned index: a
+ * piecewise linear model (in the style of the PGM-index) maps a text position to the approximate
+ * rank of its predecessor with a maximum error of epsilon, and the exact rank is found by a binary
+ * search of the bit-packed positions around the approximation. The model is built in a single
+ * streaming pass over the positions using the shrinking cone algorithm.
+ **/
+template <int epsilon = 64>
+class StartIndexPGM
+{
+
+private:
+
+    // a segment's line passes through (key, rank); +2 covers floating point error and queries that
+    // fall between two keys
+    static const int SEARCH_RADIUS = epsilon + 2;
+
+    struct Segment
+    {
+        uint64_t rank;
+        double slope;
+    };
+
+    uint64_t size;
+    sdsl::int_vector<> positions;
+
+    // the first key of each segment is kept apart from the segments for a compact search
+    std::vector<uint64_t> segmentKeys;
+    std::vector<Segment> segments;
+
+    void addSegment(uint64_t key, uint64_t rank, double minSlope, double maxSlope)
+    {
+        double slope = (maxSlope == std::numeric_limits<double>::infinity()) ? 0 : (minSlope + maxSlope) / 2;
+        segmentKeys.push_back(key);
+        segments.push_back({rank, slope});
+    }
+
+public:
+
+    StartIndexPGM(const StartIndexPGM&) = delete;
+    StartIndexPGM& operator=(const StartIndexPGM&) = delete;
+
+    /**
+      * @param positions The sorted text positions where the start rule's characters begin.
+      * @param size The number of positions.
+      * @param textLength The length of the text.
+      */
+    StartIndexPGM(const uint64_t* positions, uint64_t size, uint64_t textLength): size(size)
+    {
+        this->positions = sdsl::int_vector<>(size, 0, 64 - std::countl_zero(textLength | 1));
+
+        // fit segments with a cone of slopes that keep every position within epsilon
+        uint64_t key = 0, rank = 0, dx;
+        double minSlope = 0, maxSlope = std::numeric_limits<double>::infinity(), lo, hi;
+        for (uint64_t i = 0; i < size; i++) {
+            this->positions[i] = positions[i];
+            if (i == 0) {
+                key = positions[i];
+                continue;
+            }
+            dx = positions[i] - key;
+            lo = ((double) i - epsilon - rank) / dx;
+            hi = ((double) i + epsilon - rank) / dx;
+            lo = std::max(minSlope, lo);
+            hi = std::min(maxSlope, hi);
+            // the position doesn't fit in the cone; start a new segment at it
+            if (lo > hi) {
+                addSegment(key, rank, minSlope, maxSlope);
+                key = positions[i];
+                rank = i;
+                minSlope = 0;
+                maxSlope = std::numeric_limits<double>::infinity();
+            } else {
+                minSlope = lo;
+                maxSlope = hi;
+            }
+        }
+        addSegment(key, rank, minSlope, maxSlope);
+        segmentKeys.shrink_to_fit();
+        segments.shrink_to_fit();
+    }
+
+    uint64_t numSegments()
+    {
+        return segments.size();
+    }
+
+    uint64_t modelSize()
+    {
+        return (sizeof(uint64_t) + sizeof(Segment)) * segments.size();
+    }
+
+    uint64_t memSize()
+    {
+        return modelSize() + sdsl::size_in_bytes(positions);
+    }
+
+    /**
+      * Selects the largest start position that is less than or equal to i and computes its rank.
+      *
+      * @param i The text position to query.
+      * @param rank The number of start positions in [0, i].
+      * @param select The largest start position that is less than or equal to i.
+      */
+    void predecessor(uint64_t i, int& rank, uint64_t& select)
+    {
+        // find the segment whose first key is the largest key <= i
+        uint64_t s = std::upper_bound(segmentKeys.begin(), segmentKeys.end(), i) - segmentKeys.begin() - 1;
+        const Segment& segment = segments[s];
+        int64_t first = segment.rank;
+        int64_t last = ((s + 1 < segments.size()) ? segments[s + 1].rank : size) - 1;
+
+        // approximate the rank; queries past the segment's last key extrapolate beyond it
+        int64_t approximation = first + (int64_t) (segment.slope * (i - segmentKeys[s]));
+        approximation = std::min(approximation, last);
+
+        // bound the search by the approximation and the segment's ranks
+        uint64_t lo = std::max(first, approximation - SEARCH_RADIUS);
+        uint64_t hi = std::min(last, approximation + SEARCH_RADIUS) + 1;
+
+        // binary search for the last position <= i
+        uint64_t n = hi - lo;
+        while (n > 1) {
+            uint64_t half = n / 2;
+            lo = (positions[lo + half] <= i) ? lo + half : lo;
+            n -= half;
+        }
+        rank = lo + 1;
+        select = positions[lo];
+    }
+};
+
+}
+
+#endif
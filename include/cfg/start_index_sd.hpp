@@ -0,0 +1,137 @@
+#ifndef INCLUDED_CFG_START_INDEX_SD
+#define INCLUDED_CFG_START_INDEX_SD
+
+#include <bit>
+#include <cstdint>
+#include <sdsl/bit_vectors.hpp>
+#include <sdsl/util.hpp>
+
+namespace cfg {
+
+/**
+ * Indexes the text positions where the start rule's characters begin using an Elias-Fano encoded
+ * sd_vector. Predecessor queries are answered by a single scan of the high bits that yields both
+ * the rank and the selected position, instead of a rank followed by a select.
+ **/
+class StartIndexSD
+{
+
+private:
+
+    sdsl::sd_vector<> bitvector;
+    sdsl::sd_vector<>::rank_1_type bitvectorRank;
+    sdsl::sd_vector<>::select_1_type bitvectorSelect;
+
+    /**
+      * Counts the consecutive set bits in the high bits that end at position pos (inclusive).
+      */
+    uint64_t onesBefore(const uint64_t* data, int64_t pos)
+    {
+        uint64_t count = 0, run;
+        while (pos >= 0) {
+            // shift the bit at pos into the most significant position
+            run = std::countl_one(data[pos >> 6] << (63 - (pos & 63)));
+            count += run;
+            if (run <= (uint64_t) (pos & 63)) break;
+            pos -= run;
+        }
+        return count;
+    }
+
+    /**
+      * Gets the position of the last set bit in the high bits at or before position pos.
+      */
+    uint64_t lastOneBefore(const uint64_t* data, int64_t pos)
+    {
+        uint64_t word = data[pos >> 6] & (~((uint64_t) 0) >> (63 - (pos & 63)));
+        pos >>= 6;
+        while (word == 0) {
+            word = data[--pos];
+        }
+        return (pos << 6) + 63 - std::countl_zero(word);
+    }
+
+public:
+
+    StartIndexSD(const StartIndexSD&) = delete;
+    StartIndexSD& operator=(const StartIndexSD&) = delete;
+
+    /**
+      * @param positions The sorted text positions where the start rule's characters begin.
+      * @param size The number of positions.
+      * @param textLength The length of the text.
+      */
+    StartIndexSD(const uint64_t* positions, uint64_t size, uint64_t textLength)
+    {
+        sdsl::bit_vector tmpBitvector(textLength, 0);
+        for (uint64_t i = 0; i < size; i++) {
+            tmpBitvector[positions[i]] = 1;
+        }
+        bitvector = sdsl::sd_vector<>(tmpBitvector);
+        bitvectorRank = sdsl::sd_vector<>::rank_1_type(&bitvector);
+        bitvectorSelect = sdsl::sd_vector<>::select_1_type(&bitvector);
+    }
+
+    uint64_t memSize()
+    {
+        return sdsl::size_in_bytes(bitvector) +
+               sdsl::size_in_bytes(bitvectorRank) +
+               sdsl::size_in_bytes(bitvectorSelect);
+    }
+
+    /**
+      * Selects the largest start position that is less than or equal to i and computes its rank
+      * using a separate rank and select query.
+      *
+      * @param i The text position to query.
+      * @param rank The number of start positions in [0, i].
+      * @param select The largest start position that is less than or equal to i.
+      */
+    void rankSelect(uint64_t i, int& rank, uint64_t& select)
+    {
+        // i+1 because rank is exclusive [0, i) and we want inclusive [0, i]
+        rank = bitvectorRank.rank(i + 1);
+        select = bitvectorSelect.select(rank);
+    }
+
+    /**
+      * Selects the largest start position that is less than or equal to i and computes its rank
+      * in a single pass over the Elias-Fano high bits.
+      *
+      * @param i The text position to query.
+      * @param rank The number of start positions in [0, i].
+      * @param select The largest start position that is less than or equal to i.
+      */
+    void predecessor(uint64_t i, int& rank, uint64_t& select)
+    {
+        const uint8_t wl = bitvector.wl;
+        const uint64_t* high = bitvector.high.data();
+        uint64_t highValue = i >> wl;
+        uint64_t lowValue = i & sdsl::bits::lo_set[wl];
+
+        // the zero that terminates i's bucket and the number of values in buckets <= i's bucket
+        uint64_t zeroPos = bitvector.high_0_select(highValue + 1);
+        int64_t r = zeroPos - highValue;
+
+        // scan the bucket for the largest low part <= i's low part
+        uint64_t bucketSize = onesBefore(high, (int64_t) zeroPos - 1);
+        for (uint64_t j = 0; j < bucketSize; j++) {
+            r--;
+            if (bitvector.low[r] <= lowValue) {
+                rank = r + 1;
+                select = (highValue << wl) | bitvector.low[r];
+                return;
+            }
+        }
+
+        // the predecessor is the last value in a preceding bucket
+        r--;
+        uint64_t onePos = lastOneBefore(high, (int64_t) (zeroPos - bucketSize) - 1);
+        rank = r + 1;
+        select = ((onePos - r) << wl) | bitvector.low[r];
+    }
+};
+
+}
+
+#endif
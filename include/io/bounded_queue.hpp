@@ -0,0 +1,82 @@
+#ifndef INCLUDED_IO_BOUNDED_QUEUE
+#define INCLUDED_IO_BOUNDED_QUEUE
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+
+namespace io {
+
+/**
+ * A queue between the stages of a pipeline that blocks producers when it's full, so a slow stage
+ * limits how much work the stages before it buffer. Closing the queue wakes all waiting threads;
+ * consumers still get the items that were pushed before it was closed.
+ **/
+template <class T>
+class BoundedQueue
+{
+
+private:
+
+    uint64_t capacity;
+    std::deque<T> items;
+    bool closed = false;
+
+    std::mutex mutex;
+    std::condition_variable notFull;
+    std::condition_variable notEmpty;
+
+public:
+
+    /**
+      * @param capacity The number of items the queue holds before push blocks.
+      */
+    BoundedQueue(uint64_t capacity): capacity(capacity) { }
+
+    /**
+      * Adds an item to the back of the queue, waiting for room if it's full.
+      *
+      * @param item The item to add.
+      * @return False if the queue was closed, in which case the item is dropped.
+      */
+    bool push(T item)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        notFull.wait(lock, [this]() { return closed || items.size() < capacity; });
+        if (closed) return false;
+        items.push_back(std::move(item));
+        notEmpty.notify_one();
+        return true;
+    }
+
+    /**
+      * Removes the item at the front of the queue, waiting for one if it's empty.
+      *
+      * @param item Set to the item that was removed.
+      * @return False if the queue is closed and empty.
+      */
+    bool pop(T& item)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        notEmpty.wait(lock, [this]() { return closed || !items.empty(); });
+        if (items.empty()) return false;
+        item = std::move(items.front());
+        items.pop_front();
+        notFull.notify_one();
+        return true;
+    }
+
+    /** Closes the queue so no more items can be pushed. */
+    void close()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        closed = true;
+        notFull.notify_all();
+        notEmpty.notify_all();
+    }
+};
+
+}
+
+#endif
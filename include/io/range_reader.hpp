@@ -0,0 +1,69 @@
+#ifndef INCLUDED_IO_RANGE_READER
+#define INCLUDED_IO_RANGE_READER
+
+#include <cstdint>
+
+namespace io {
+
+/**
+ * Parses (begin, end) pairs of unsigned decimal integers from a file descriptor, e.g. a file or
+ * stdin. The integers may be separated by any whitespace, though typically each pair is on its own
+ * line. The input is read in large blocks and parsed without going through a stream.
+ **/
+class RangeReader
+{
+
+private:
+
+    int fd;
+    char* buffer;
+    uint64_t bufferSize;
+    char* cursor;
+    char* limit;
+    bool eof;
+    // the number of pairs that have been read, for error messages
+    uint64_t numRanges;
+
+    /**
+      * Reads the next block of input if the buffer has been consumed.
+      *
+      * @return False if there is no input left.
+      * @throws Exception if the input can't be read.
+      */
+    bool fill();
+
+    /**
+      * Parses the next integer.
+      *
+      * @param value Set to the integer.
+      * @return False if there is no input left before the integer.
+      * @throws Exception if the input isn't an integer.
+      */
+    bool parse(uint64_t& value);
+
+public:
+
+    /**
+      * @param fd The file descriptor to read from; it isn't closed by the reader.
+      * @param bufferSize The size of the blocks to read.
+      */
+    RangeReader(int fd, uint64_t bufferSize = 1 << 20);
+    ~RangeReader();
+
+    RangeReader(const RangeReader&) = delete;
+    RangeReader& operator=(const RangeReader&) = delete;
+
+    /**
+      * Reads the next pair.
+      *
+      * @param begin Set to the first integer of the pair.
+      * @param end Set to the second integer of the pair.
+      * @return False if there are no pairs left.
+      * @throws Exception if the input is malformed or ends in the middle of a pair.
+      */
+    bool next(uint64_t& begin, uint64_t& end);
+};
+
+}
+
+#endif
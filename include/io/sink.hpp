@@ -0,0 +1,194 @@
+#ifndef INCLUDED_IO_SINK
+#define INCLUDED_IO_SINK
+
+#include <cstdint>
+#include <vector>
+#include <sys/uio.h>  // iovec
+
+namespace io {
+
+/**
+ * An abstract output that decoders write to one character at a time or in blocks. Characters are
+ * written into a buffer window with an inline check, and the implementation is only called when
+ * the window is full, so writing a character costs the same as writing to an array.
+ **/
+class Sink
+{
+
+protected:
+
+    char* cursor = nullptr;
+    char* limit = nullptr;
+
+    /**
+      * Makes room in the buffer window, i.e. cursor < limit afterwards.
+      *
+      * @throws Exception if the output can't be written or has no room left.
+      */
+    virtual void overflow() = 0;
+
+public:
+
+    virtual ~Sink() { }
+
+    void put(char c)
+    {
+        if (cursor == limit) overflow();
+        *cursor++ = c;
+    }
+
+    /**
+      * Writes a block of characters. The default implementation copies the block into the buffer
+      * window.
+      *
+      * @param data The characters to write.
+      * @param length The number of characters to write.
+      */
+    virtual void write(const char* data, uint64_t length);
+
+    /** Writes everything that has been buffered to the output. */
+    virtual void flush() = 0;
+};
+
+/** Writes to a caller's array of a fixed capacity. */
+class BufferSink : public Sink
+{
+
+private:
+
+    char* buffer;
+
+protected:
+
+    void overflow();
+
+public:
+
+    /**
+      * @param buffer The array to write to.
+      * @param capacity The size of the array.
+      */
+    BufferSink(char* buffer, uint64_t capacity);
+
+    void flush() { }
+
+    /** @return The number of characters that have been written. */
+    uint64_t size() const { return cursor - buffer; }
+};
+
+/** Writes to a file descriptor through a large write-combining buffer. */
+class FdSink : public Sink
+{
+
+private:
+
+    int fd;
+    char* buffer;
+    uint64_t bufferSize;
+
+protected:
+
+    void overflow();
+
+public:
+
+    /**
+      * @param fd The file descriptor to write to; it isn't closed by the sink.
+      * @param bufferSize The size of the buffer.
+      */
+    FdSink(int fd, uint64_t bufferSize = 1 << 20);
+    ~FdSink();
+
+    FdSink(const FdSink&) = delete;
+    FdSink& operator=(const FdSink&) = delete;
+
+    /** Writes blocks at least as large as the buffer directly instead of copying them. */
+    void write(const char* data, uint64_t length);
+
+    void flush();
+};
+
+/**
+ * Writes to a file descriptor with writev. Characters are buffered in chunks and blocks of at least
+ * a chunk are referenced instead of copied, so they must stay unmodified until the next flush.
+ **/
+class WritevSink : public Sink
+{
+
+private:
+
+    int fd;
+    uint64_t chunkSize;
+    int maxChunks;
+    std::vector<char*> chunks;
+    int numChunks;
+    // the buffered chunks and referenced blocks in the order they were written
+    std::vector<struct iovec> iovecs;
+    char* chunkBegin;
+
+    void endChunk();
+
+protected:
+
+    void overflow();
+
+public:
+
+    /**
+      * @param fd The file descriptor to write to; it isn't closed by the sink.
+      * @param chunkSize The size of each buffered chunk.
+      * @param maxChunks The number of chunks to fill before they are written with one call.
+      */
+    WritevSink(int fd, uint64_t chunkSize = 1 << 18, int maxChunks = 16);
+    ~WritevSink();
+
+    WritevSink(const WritevSink&) = delete;
+    WritevSink& operator=(const WritevSink&) = delete;
+
+    void write(const char* data, uint64_t length);
+
+    void flush();
+};
+
+/**
+ * Writes to a pipe with vmsplice, which maps the sink's pages into the pipe instead of copying
+ * them. The pipe's capacity is set to the buffer size, so once a buffer has been fully spliced the
+ * reader has consumed the other buffer and it can be reused. Spliced characters must not be
+ * changed, so the reader must consume the pipe, e.g. with read or splice, rather than hold on to
+ * the pages.
+ **/
+class VmspliceSink : public Sink
+{
+
+private:
+
+    int fd;
+    uint64_t bufferSize;
+    char* buffers[2];
+    int current;
+    // the end of the current buffer's characters that have been spliced
+    char* flushed;
+
+protected:
+
+    void overflow();
+
+public:
+
+    /**
+      * @param fd The write end of a pipe; it isn't closed by the sink.
+      * @param bufferSize The size of each of the two buffers and of the pipe.
+      * @throws Exception if fd isn't a pipe or the buffers can't be allocated.
+      */
+    VmspliceSink(int fd, uint64_t bufferSize = 1 << 20);
+    ~VmspliceSink();
+
+    VmspliceSink(const VmspliceSink&) = delete;
+    VmspliceSink& operator=(const VmspliceSink&) = delete;
+
+    void flush();
+};
+
+}
+
+#endif
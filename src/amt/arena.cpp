@@ -0,0 +1,122 @@
+#include <algorithm>
+#include <stdexcept>
+#include <sys/mman.h>
+#include "amt/arena.hpp"
+
+namespace amt {
+
+// construction
+
+Arena::Arena(uint64_t size, bool hugePages, int segmentBits): segmentBits(segmentBits), hugePages(hugePages)
+{
+    // a segment must fit the largest allocation, and a huge page
+    while ((((uint64_t) 1) << this->segmentBits) < Arena::MAX_ALLOCATION) {
+        this->segmentBits++;
+    }
+    if (hugePages && this->segmentBits < Arena::DEFAULT_SEGMENT_BITS) {
+        this->segmentBits = Arena::DEFAULT_SEGMENT_BITS;
+    }
+    segmentSize = ((uint64_t) 1) << this->segmentBits;
+    segmentMask = segmentSize - 1;
+
+    freeIdx = 0;
+    numAllocated = 0;
+    numMapped = 0;
+    mappedEnd = 0;
+    do {
+        addSegment();
+    } while (segments.size() * segmentSize < size);
+}
+
+Arena::Arena(const MappedFile& file, uint64_t offset, bool hugePages): hugePages(hugePages)
+{
+    // the header: segmentBits, numAllocated, freeIdx
+    uint64_t* header = file.words(offset, Arena::HEADER_SIZE);
+    if (header[0] < 7 || header[0] > 40 || header[1] > header[2]) {
+        throw std::runtime_error("saved AMT has an invalid arena");
+    }
+    segmentBits = (int) header[0];
+    segmentSize = ((uint64_t) 1) << segmentBits;
+    segmentMask = segmentSize - 1;
+    numAllocated = header[1];
+    uint64_t* words = file.words(offset + Arena::HEADER_SIZE, header[2]);
+
+    mappedEnd = header[2];
+    numMapped = (mappedEnd + segmentSize - 1) >> segmentBits;
+    for (uint64_t i = 0; i < numMapped; i++) {
+        segments.push_back(words + (i << segmentBits));
+    }
+    // the last mapped segment ends with the file, so new allocations start a new segment
+    freeIdx = numMapped << segmentBits;
+}
+
+// destruction
+
+Arena::~Arena()
+{
+    for (uint64_t i = numMapped; i < segments.size(); i++) {
+        munmap(segments[i], segmentSize * sizeof(uint64_t));
+    }
+}
+
+// private
+
+void Arena::addSegment()
+{
+    uint64_t bytes = segmentSize * sizeof(uint64_t);
+    void* segment = MAP_FAILED;
+    if (hugePages) {
+        segment = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    }
+    // fall back to transparent huge pages if none are reserved
+    if (segment == MAP_FAILED) {
+        segment = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (segment == MAP_FAILED) {
+            throw std::runtime_error("failed to allocate arena segment");
+        }
+        if (hugePages) {
+            madvise(segment, bytes, MADV_HUGEPAGE);
+        }
+    }
+    segments.push_back((uint64_t*) segment);
+}
+
+// public
+
+uint64_t Arena::allocate(int size)
+{
+    uint64_t segment = freeIdx >> segmentBits;
+    // start the next segment if the allocation doesn't fit in this one
+    if ((freeIdx & segmentMask) + size > segmentSize) {
+        segment++;
+        freeIdx = segment << segmentBits;
+    }
+    if (segment == segments.size()) {
+        addSegment();
+    }
+    uint64_t ref = freeIdx;
+    freeIdx += size;
+    numAllocated += size;
+    return ref;
+}
+
+void Arena::save(std::ostream& out) const
+{
+    uint64_t header[Arena::HEADER_SIZE] = {(uint64_t) segmentBits, numAllocated, freeIdx};
+    out.write((const char*) header, sizeof(header));
+    const uint64_t zero = 0;
+    for (uint64_t ref = 0; ref < freeIdx; ref += segmentSize) {
+        uint64_t n = std::min(segmentSize, freeIdx - ref);
+        // the last mapped segment ends with its file, and its unallocated rest is zero
+        uint64_t m = (ref < mappedEnd) ? std::min(n, mappedEnd - ref) : n;
+        out.write((const char*) segments[ref >> segmentBits], m * sizeof(uint64_t));
+        for (; m < n; m++) {
+            out.write((const char*) &zero, sizeof(uint64_t));
+        }
+    }
+    if (!out) {
+        throw std::runtime_error("failed to save arena");
+    }
+}
+
+}
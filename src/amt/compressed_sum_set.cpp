@@ -1,5 +1,9 @@
 #include <algorithm>
 #include <bit>
+#include <cstdlib>  // aligned_alloc, free
+#include <numeric>  // iota
+#include <stdexcept>
+#include <vector>
 #include "amt/bitops.hpp"
 #include "amt/key.hpp"
 #include "amt/compressed_sum_set.hpp"
@@ -8,29 +12,34 @@
 
 namespace amt {
 
-void CompressedSumSet::tmp(int len)
+template <class key_codec>
+void CompressedSumSet<key_codec>::tmp()
 {
+    const int len = key_codec::LENGTH;
     // output values and sums
     uint8_t* key = new uint8_t[len];
     tmp(root, key, 0, len);
     delete[] key;
 }
 
-void CompressedSumSet::tmp(uint64_t nodeRef, uint8_t* key, int off, int len)
+template <class key_codec>
+void CompressedSumSet<key_codec>::tmp(uint64_t nodeRef, uint8_t* key, int off, int len)
 {
-    uint64_t bitMap = mem[(int) nodeRef];
-    if (bitMap == 0 && !compressed[(int) nodeRef]) {
+    if ((nodeRef & CompressedSumSet<key_codec>::TAIL_FLAG) != 0) {
+        nodeRef ^= CompressedSumSet<key_codec>::TAIL_FLAG;
+        std::cerr << "v2 sum : " << mem[nodeRef + 1] << std::endl;
+        std::cerr << "v2 ckey (compressed): " << mem[nodeRef] << std::endl;
         return;
     }
-    if (compressed[(int) nodeRef]) {
-        std::cerr << "v2 sum : " << mem[(int) nodeRef + 1] << std::endl;
-        std::cerr << "v2 ckey (compressed): " << bitMap << std::endl;
+    uint64_t bitMap = mem[nodeRef];
+    if (bitMap == 0) {
         return;
     }
-    int numChildren = std::popcount(bitMap);
+    uint64_t first = nodeRef + 1;
     if (off == len - 2) {
-        uint64_t sum = mem[(int) nodeRef + 1 + numChildren];
+        uint64_t sum = mem[nodeRef + 1];
         std::cerr << "v2 sum: " << sum << std::endl;
+        first++;
     }
     uint64_t bits = bitMap;
     while (bits != 0) {
@@ -38,16 +47,16 @@ void CompressedSumSet::tmp(uint64_t nodeRef, uint8_t* key, int off, int len)
         int bitNum = std::countr_zero(bitPos);
         key[off] = (uint8_t) bitNum;
         if (off == len - 2) {
-            uint64_t value = mem[(int) nodeRef + 1 + std::popcount(bitMap & (bitPos - 1))];
+            uint64_t value = mem[first + std::popcount(bitMap & (bitPos - 1))];
             uint64_t bits2 = value;
             while (bits2 != 0) {
                 uint64_t bitPos2 = bits2 & -bits2; bits2 ^= bitPos2;
                 int bitNum2 = std::countr_zero(bitPos2);
                 key[off+1] = (uint8_t) bitNum2;
-                std::cerr << "v2 ckey: " << get6Int(key) << std::endl;
+                std::cerr << "v2 ckey: " << key_codec::get(key) << std::endl;
             }
         } else {
-            uint64_t childNode = mem[(int) nodeRef + 1 + std::popcount(bitMap & (bitPos - 1))];
+            uint64_t childNode = mem[first + std::popcount(bitMap & (bitPos - 1))];
             tmp(childNode, key, off + 1, len);
         }                
     }
@@ -55,185 +64,207 @@ void CompressedSumSet::tmp(uint64_t nodeRef, uint8_t* key, int off, int len)
 
 // construction
 
-CompressedSumSet::CompressedSumSet(Set& set, int len, GetKey getKey, SetKey setKey): getKey(getKey), setKey(setKey) {
+template <class key_codec>
+CompressedSumSet<key_codec>::CompressedSumSet(KeyStream keys, bool leafCounts, uint64_t source): leafCounts(leafCounts), source(source) {
     // initial values
-    memSize = 0;
-    sumCount = 0;
-    root = CompressedSumSet::KNOWN_EMPTY_NODE;
-    count = set.size();
+    mem = nullptr;
     // pre-compute the memory required
-    computeCompressedSize(set, len);
-    // allocate the memory
-    int buffSize = len * 2;  // tails are compressed after they're added
-    mem = new uint64_t[memSize + buffSize + sumCount]; 
-    compressed = new bool[memSize + sumCount];
+    numWords = construct(keys(), false);
+    // allocate the memory aligned to cache lines so the layout lines up with them; the padding and
+    // the KNOWN_EMPTY_NODE word are zero
+    uint64_t lineBytes = CompressedSumSet<key_codec>::LINE_WORDS * sizeof(uint64_t);
+    uint64_t bytes = (numWords * sizeof(uint64_t) + lineBytes - 1) / lineBytes * lineBytes;
+    mem = (uint64_t*) std::aligned_alloc(lineBytes, bytes);
+    if (mem == nullptr) {
+        throw std::runtime_error("failed to allocate the set");
+    }
+    std::fill(mem, mem + numWords, 0);
     // construct the tree
-    construct(set, len);
-    std::cerr << "memSize: " << memSize << std::endl;
-    std::cerr << "sumCount: " << sumCount << std::endl;
-    std::cerr << "total: " << memSize + sumCount << std::endl;
-    std::cerr << "memory: " << 64 * (memSize + sumCount) << " bits" << std::endl;
+    construct(keys(), true);
 }
 
-void CompressedSumSet::computeCompressedSize(Set& set, int len)
-{
-    int tailLen = computeCompressedSize(set, len, set.root, 0);
-    // edge case: root is a tail, i.e. there's only one value in the set
-    if (tailLen > 0) {
-        this->memSize += 1;
-    // there's no pointer to the root node
-    } else {
-        this->memSize -= 1;
+template <class key_codec>
+CompressedSumSet<key_codec>::CompressedSumSet(std::string filename, uint64_t source): file(filename, CompressedSumSet<key_codec>::MAGIC) {
+    uint64_t* header = file.words(0, CompressedSumSet<key_codec>::SAVED_HEADER_SIZE);
+    if (header[1] != (uint64_t) key_codec::LENGTH) {
+        throw std::runtime_error(filename + " is a set of keys of a different length");
+    }
+    leafCounts = header[2] != 0;
+    root = header[3];
+    count = header[4];
+    numWords = header[5];
+    nodeCount = header[6];
+    sumCount = header[7];
+    leafCountCount = header[8];
+    padCount = header[9];
+    this->source = header[10];
+    if (this->source != source) {
+        throw std::runtime_error(filename + " is a set of different keys");
     }
+    mem = file.words(CompressedSumSet<key_codec>::SAVED_HEADER_SIZE, numWords);
 }
 
-int CompressedSumSet::computeCompressedSize(Set& set, int len, uint64_t nodeRef, int off) {
-    uint64_t bitMap = set.mem[(int) nodeRef];
-    if (bitMap == 0) {
-        return 0;
-    }
-    bool isTail = std::popcount(bitMap) == 1;  // there's only one bit set
-    // leaf parents get a partial sum; will be used by leaf if tail compressed
-    if (off == len - 2) {
-        this->sumCount += 1;
-    }
-    // iterate the set bits
-    uint64_t bits = bitMap;
-    while (bits != 0) {
-        uint64_t bitPos = bits & -bits; bits ^= bitPos; // get rightmost bit and clear it
-        // the bit's nodeRef is a leaf
-        if (off == len - 2) {
-            uint64_t value = set.mem[(int) nodeRef + 1 + std::popcount(bitMap & (bitPos - 1))];
-            // the leaf and nodeRef are the start of a compressible tail
-            if (isTail && std::popcount(value) == 1) {
-                return 2;  // bitMap + value (leaf) = 2 non-branching nodes
+template <class key_codec>
+uint64_t CompressedSumSet<key_codec>::construct(Set::NextKey nextKey, bool fill) {
+    const int len = key_codec::LENGTH;
+    // the node being built at each level, except the leaves, the children it has so far, the
+    // number of keys in its subtree, and the rank of its first key; a node's last child stays open
+    // until a key with a different prefix arrives
+    std::vector<uint64_t> bitMaps(len - 1, 0);
+    std::vector<uint64_t> children((len - 1) * 64);
+    std::vector<uint64_t> counts(len - 1, 1);
+    std::vector<uint64_t> ranks(len - 1, 0);
+    std::vector<uint8_t> previous(len), key(len);
+    uint64_t leaf, child = 0;
+    uint64_t idx = 1;  // idx starts at 1 because 0 is KNOWN_EMPTY_NODE
+    int p, d;
+
+    nodeCount = 0;
+    sumCount = 0;
+    leafCountCount = 0;
+    padCount = 0;
+    root = CompressedSumSet<key_codec>::KNOWN_EMPTY_NODE;
+    count = 0;
+
+    // reserves the words of a node, skipping to the next cache line if the node would otherwise
+    // span more lines than it has to
+    auto place = [&](int size) {
+        const int lineWords = CompressedSumSet<key_codec>::LINE_WORDS;
+        int offset = idx % lineWords;
+        int lines = (size + lineWords - 1) / lineWords;
+        if (offset + size > lines * lineWords) {
+            idx += lineWords - offset;
+            padCount += lineWords - offset;
+        }
+        uint64_t nodeRef = idx;
+        idx += size;
+        return nodeRef;
+    };
+
+    // a node that isn't tail compressed; leaf parents store the partial sum after their bitMap and,
+    // optionally, the 16 bit count of keys before each leaf after their leafs
+    auto writeNode = [&](int level) {
+        int numChildren = std::popcount(bitMaps[level]);
+        int numSums = (level == len - 2) ? 1 : 0;
+        int numCountWords = (numSums && leafCounts) ? (numChildren + 3) / 4 : 0;
+        uint64_t nodeRef = place(1 + numSums + numChildren + numCountWords);
+        uint64_t* nodeChildren = children.data() + level * 64;
+        if (fill) {
+            mem[nodeRef] = bitMaps[level];
+            if (numSums) mem[nodeRef + 1] = ranks[level];
+            std::copy(nodeChildren, nodeChildren + numChildren, mem + nodeRef + 1 + numSums);
+            uint64_t* countWords = mem + nodeRef + 1 + numSums + numChildren;
+            uint64_t leafCount = 0;
+            for (int i = 0; numCountWords > 0 && i < numChildren; i++) {
+                countWords[i / 4] |= leafCount << (16 * (i % 4));
+                leafCount += std::popcount(nodeChildren[i]);
             }
-            this->memSize += 1;
-        } else {
-            uint64_t childNode = set.mem[(int) nodeRef + 1 + std::popcount(bitMap & (bitPos - 1))];
-            int tailLen = computeCompressedSize(set, len, childNode, off + 1);
-            // the descendants and nodeRef are a compressible tail
-            if (isTail && tailLen > 0) {
-                return tailLen + 1;
-            // the descendants are a compressible tail
-            } else if (tailLen > 0) {
-                this->memSize += 2;  // tail compressed node and nodeRef to it
+        }
+        nodeCount += 1 + numChildren;
+        sumCount += numSums;
+        leafCountCount += numCountWords;
+        bitMaps[level] = 0;
+        return nodeRef;
+    };
+
+    // a node whose subtree has one key, i.e. the previous key; references to it are flagged
+    auto writeTail = [&](int level) {
+        uint64_t nodeRef = place(2);
+        if (fill) {
+            mem[nodeRef] = key_codec::get(previous.data());
+            mem[nodeRef + 1] = ranks[level];
+        }
+        nodeCount++;
+        sumCount++;
+        bitMaps[level] = 0;
+        return nodeRef | CompressedSumSet<key_codec>::TAIL_FLAG;
+    };
+
+    // closes the levels below the given one, adding each finished node to its parent
+    auto close = [&](int level) {
+        child = leaf;
+        for (d = len - 2; d > level; d--) {
+            bitMaps[d] |= ((uint64_t) 1) << previous[d];
+            children[d * 64 + std::popcount(bitMaps[d]) - 1] = child;
+            if (counts[d] > 1) {
+                child = writeNode(d);
+            // a parent with one key is part of the same tail
+            } else if (counts[d - 1] > 1) {
+                child = writeTail(d);
+            } else {
+                bitMaps[d] = 0;
             }
         }
-    }
-    // bitMap is not tail compressible
-    this->memSize += 2;  // nodeRef + bitMap
-    return 0;
-}
-
-void CompressedSumSet::construct(Set& set, int len)
-{
-    uint8_t* key = new uint8_t[len];
-    int idx = 1;  // idx starts at 1 because 0 is KNOWN_EMPTY_NODE
-    root = idx;
-    int sum = 0;
-    int tailLen = construct(set, len, set.root, key, 0, idx, sum);
-    // edge case: root is a tail, i.e. there's only one value in the set
-    if (tailLen > 0) {
-        mem[root] = getKey(key);
-        compressed[root] = true;
-        mem[root + 1] = sum;  // should be 0
-    // edge case: the set is empty
-    } else if (idx == 1) {
-        root = CompressedSumSet::KNOWN_EMPTY_NODE;
-    }
-    delete[] key;
-}
+        bitMaps[level] |= ((uint64_t) 1) << previous[level];
+        children[level * 64 + std::popcount(bitMaps[level]) - 1] = child;
+    };
 
-int CompressedSumSet::construct(Set& set, int len, uint64_t nodeRef, uint8_t* key, int off, int& idx, int& sum) {
-    uint64_t bitMap = set.mem[(int) nodeRef];
-    // prepare the mem indexes
-    //int nodeIdx = idx;
-    int childIdx = idx + 1;
-    int numChildren = std::popcount(bitMap);
-    bool isTail = numChildren == 1;  // there's only one bit set
-    // assume the node is not tail compressed
-    mem[idx] = bitMap;
-    compressed[idx] = false;
-    // space for children (leafs) and partial sum
-    if (off == len - 2) {
-        // save the partial sum before processing the leafs
-        mem[idx + 1 + numChildren] = sum;
-        compressed[idx + 1 + numChildren] = false;
-        idx += numChildren + 2;
-    // space for children (not leafs) only
-    } else {
-        idx += numChildren + 1;
+    if (!nextKey(previous.data())) {
+        return idx;
     }
-    // iterate the set bits
-    uint64_t bits = bitMap;
-    while (bits != 0) {
-        uint64_t bitPos = bits & -bits; bits ^= bitPos; // get rightmost bit and clear it
-        int bitNum = std::countr_zero(bitPos);
-        key[off] = (uint8_t) bitNum;
-        // the bit's nodeRef is a leaf
-        if (off == len - 2) {
-            uint64_t value = set.mem[(int) nodeRef + 1 + std::popcount(bitMap & (bitPos - 1))];
-            int leafValues = std::popcount(value);
-            // the leaf and nodeRef are the start of a compressible tail
-            if (isTail && leafValues == 1) {
-                uint64_t bitPos2 = value & -value;
-                int bitNum2 = std::countr_zero(bitPos2);
-                key[off + 1] = (uint8_t) bitNum2;
-                return 2;  // leaf + bitMap = 2 non-branching nodes
-            }
-            // add the leaf as the child
-            mem[childIdx] = value;
-            compressed[childIdx] = false;
-            // add the leaf's count to the sum
-            sum += leafValues;
-        } else {
-            // add a pointer to the child index
-            mem[childIdx] = idx;
-            // construct the subtree rooted at the child
-            uint64_t childNode = set.mem[(int) nodeRef + 1 + std::popcount(bitMap & (bitPos - 1))];
-            int tailLen = construct(set, len, childNode, key, off + 1, idx, sum);
-            // the descendants and bitMap are a compressible tail
-            if (isTail && tailLen > 0) {
-                return tailLen + 1;
-            // the descendants are a compressible tail but bitMap has multiple children
-            } else if (tailLen > 0) {
-                // add the tail as the child
-                mem[mem[childIdx]] = getKey(key);
-                compressed[mem[childIdx]] = true;
-                // add the sum for the tail
-                mem[mem[childIdx] + 1] = sum;
-                compressed[mem[childIdx] + 1] = false;
-                // add the tail's count to the sum
-                sum += 1;
-                // adjust the index because the tail is compressed
-                // idx - ((2 * tailLen) - 1) + 2
-                // idx: currently at the index after the non-compressed tail
-                // (2 * tailLen) - 1: the nodes and nodeRefs of the tail; -1 because the last node doesn't have a nodeRef
-                // + 2: a node to store the tail-compressed value and a nodeRef to points to it
-                idx = idx - (2 * tailLen) + 3;
-            }
+    leaf = ((uint64_t) 1) << previous[len - 1];
+    count = 1;
+    while (nextKey(key.data())) {
+        for (p = 0; p < len && key[p] == previous[p]; p++);
+        // duplicate key
+        if (p == len) continue;
+        if (key[p] < previous[p]) {
+            throw std::runtime_error("keys must be in ascending order");
         }
-        childIdx++;
+        // the key is in the subtrees of the open nodes up to the level it differs at
+        for (d = 0; d <= std::min(p, len - 2); d++) {
+            counts[d]++;
+        }
+        // the key is in the open leaf
+        if (p == len - 1) {
+            // later keys are compared to this one, so repeats of it are caught
+            previous[len - 1] = key[len - 1];
+            leaf |= ((uint64_t) 1) << key[len - 1];
+            count++;
+            continue;
+        }
+        close(p);
+        for (d = p + 1; d < len - 1; d++) {
+            counts[d] = 1;
+            ranks[d] = count;
+        }
+        std::copy(key.begin(), key.end(), previous.begin());
+        leaf = ((uint64_t) 1) << key[len - 1];
+        count++;
     }
-    // nodeRef is not tail compressible
-    //mem[nodeIdx] = bitMap;
-    //compressed[nodeIdx] = false;
-    return 0;
+
+    // close all the levels and the root
+    close(0);
+    root = (counts[0] > 1) ? writeNode(0) : writeTail(0);
+    return idx;
 }
 
 // destruction
 
-CompressedSumSet::~CompressedSumSet() {
-    delete[] mem;
-    delete[] compressed;
+template <class key_codec>
+CompressedSumSet<key_codec>::~CompressedSumSet() {
+    if (!file.isMapped()) {
+        std::free(mem);
+    }
 }
 
 // set operations
 
+template <class key_codec>
+uint64_t CompressedSumSet<key_codec>::leafRank(uint64_t nodeRef, int leaf) {
+    // the partial sum is the number of keys before the node's first leaf
+    uint64_t sum = mem[nodeRef + 1];
+    const uint64_t* leafs = mem + nodeRef + 2;
+    if (leafCounts) {
+        uint64_t countWord = leafs[std::popcount(mem[nodeRef]) + leaf / 4];
+        return sum + ((countWord >> (16 * (leaf % 4))) & 0xFFFF);
+    }
+    return sum + popcountSum(leafs, leaf);
+}
+
 /*
 bool CompressedSumSet::get(uint8_t* key, int len) {
-    if (root == CompressedSumSet::KNOWN_EMPTY_NODE) {
+    if (root == CompressedSumSet<key_codec>::KNOWN_EMPTY_NODE) {
         return false;
     }
 
@@ -241,13 +272,13 @@ bool CompressedSumSet::get(uint8_t* key, int len) {
     int off = 0;
 
     for (;;) {
-        uint64_t bitMap = mem[(int) nodeRef];
+        uint64_t bitMap = mem[nodeRef];
         uint64_t bitPos = ((uint64_t) 1) << key[off++]; // mind the ++
         if ((bitMap & bitPos) == 0) {
             return false; // not found
         }
 
-        uint64_t value = mem[(int) nodeRef + 1 + std::popcount(bitMap & (bitPos - 1))];
+        uint64_t value = mem[nodeRef + 1 + std::popcount(bitMap & (bitPos - 1))];
 
         if (off == len - 1) {
             // at leaf
@@ -261,97 +292,196 @@ bool CompressedSumSet::get(uint8_t* key, int len) {
 }
 */
 
-uint64_t CompressedSumSet::predecessor(uint8_t* key, int len) {
-    if (root == CompressedSumSet::KNOWN_EMPTY_NODE) {
-        throw std::runtime_error("No key to select");
+template <class key_codec>
+bool CompressedSumSet<key_codec>::descend(Descent& d, uint64_t& rank) {
+    const int len = key_codec::LENGTH;
+    uint8_t* key = d.key;
+    uint64_t nodeRef = d.nodeRef;
+    int off = d.off;
+
+    // check if the node is tail compressed before reading it
+    if ((nodeRef & CompressedSumSet<key_codec>::TAIL_FLAG) != 0) {
+        nodeRef ^= CompressedSumSet<key_codec>::TAIL_FLAG;
+        // the rank counts the keys less than the given key, like a leaf's partial sum
+        if (mem[nodeRef] <= d.keyValue) {
+            key_codec::set(key, mem[nodeRef]);
+            rank = mem[nodeRef + 1] + (mem[nodeRef] < d.keyValue);
+        } else {
+            rank = predecessor(d.nearestNodeRef, key, d.nearestOff, len);
+        }
+        return true;
     }
 
-    uint64_t keyValue = getKey(key);
-    uint64_t nodeRef = root;
-    int off = 0;
+    // get the next node
+    uint64_t bitMap = mem[nodeRef];
 
-    uint64_t nearestNodeRef = CompressedSumSet::KNOWN_EMPTY_NODE;
-    int nearestOff = 0;
+    uint64_t bitPos = ((uint64_t) 1) << key[off];
 
-    for (;;) {
-        // get the next node
-        uint64_t bitMap = mem[(int) nodeRef];
-
-        // check if the node is tail compressed
-        if (compressed[(int) nodeRef]) {
-            if (bitMap <= keyValue) {
-                setKey(key, bitMap);
-                return mem[(int) nodeRef + 1];
-            }
-            return predecessor(nearestNodeRef, key, nearestOff, len);
-        }
+    // memoize the node if it has smaller keys
+    if (amt::lowestOneBit(bitMap) < bitPos) {
+        d.nearestNodeRef = nodeRef;
+        d.nearestOff = off;
+    }
 
-        uint64_t bitPos = ((uint64_t) 1) << key[off];
+    // key not found
+    if ((bitMap & bitPos) == 0) {
+        rank = predecessor(d.nearestNodeRef, key, d.nearestOff, len);
+        return true;
+    }
 
-        // memoize the node if it has smaller keys
-        if (amt::lowestOneBit(bitMap) < bitPos) {
-            nearestNodeRef = nodeRef;
-            nearestOff = off;
-        }
+    // get the next nodeRef/leaf; leaf parents store the partial sum before the leafs
+    uint64_t first = nodeRef + ((off == len - 2) ? 2 : 1);
+    uint64_t idx = first + std::popcount(bitMap & (bitPos - 1));
+    uint64_t value = mem[idx];
 
-        // key not found
-        if ((bitMap & bitPos) == 0) {
-            return predecessor(nearestNodeRef, key, nearestOff, len);
-        }
+    // value is a nodeRef
+    if (++off < len - 1) {
+        d.nodeRef = value;
+        d.off = off;
+        return false;
+    }
 
-        // get the next nodeRef/leaf
-        uint64_t idx = nodeRef + 1 + std::popcount(bitMap & (bitPos - 1));
-        uint64_t value = mem[(int) idx];
+    // value is a leaf
+    uint64_t bitPosLeaf = ((uint64_t) 1) << key[off];
+    // key found
+    if ((value & bitPosLeaf) != 0) {
+        uint64_t maskedLeaf = value & (bitPosLeaf - 1);
+        rank = leafRank(nodeRef, idx - first) + std::popcount(maskedLeaf);
+    // check if there's a smaller key in the leaf
+    } else if (amt::lowestOneBit(value) < bitPosLeaf) {
+        // NOTE: the return value is a bitMap instead of a partial sum
+        uint64_t maskedLeaf = predecessor(idx, key, off, len);
+        rank = leafRank(nodeRef, idx - first) + std::popcount(maskedLeaf);
+    // go back to the last node with a bit before the matched bit
+    } else {
+        rank = predecessor(d.nearestNodeRef, key, d.nearestOff, len);
+    }
+    return true;
+}
 
-        // value is a leaf
-        if (++off == len - 1) {
-            // at leaf
-            uint64_t bitPosLeaf = ((uint64_t) 1) << key[off];
-            // key found
-            if ((value & bitPosLeaf) != 0) {
-                int numChildren = std::popcount(bitMap);
-                uint64_t maskedLeaf = value & (bitPosLeaf - 1);
-                //int child = std::popcount(maskedLeaf);
-                //return mem[(int) idx + numChildren] + child;
-                // compute the partial sum
-                //int numChildren = std::popcount(bitMap);
-                uint64_t sum = mem[(int) nodeRef + 1 + numChildren];
-                for (nodeRef = nodeRef + 1; nodeRef < idx; nodeRef++) {
-                    sum += std::popcount(mem[(int) nodeRef]);
-                }
-                return sum + std::popcount(maskedLeaf);
+template <class key_codec>
+uint64_t CompressedSumSet<key_codec>::predecessor(uint8_t* key) {
+    if (root == CompressedSumSet<key_codec>::KNOWN_EMPTY_NODE) {
+        throw std::runtime_error("No key to select");
+    }
+
+    Descent d = {key, key_codec::get(key), root, 0, CompressedSumSet<key_codec>::KNOWN_EMPTY_NODE, 0};
+    uint64_t rank;
+    while (!descend(d, rank)) { }
+    return rank;
+}
+
+template <class key_codec>
+void CompressedSumSet<key_codec>::predecessors(uint64_t* values, uint64_t* ranks, uint64_t n) {
+    const int len = key_codec::LENGTH;
+    const int window = CompressedSumSet<key_codec>::BATCH_WINDOW;
+    const int maxLanes = CompressedSumSet<key_codec>::BATCH_LANES;
+    if (root == CompressedSumSet<key_codec>::KNOWN_EMPTY_NODE) {
+        throw std::runtime_error("No key to select");
+    }
+
+    // a descent and the nodes it passed at each depth, with the nearest node at the time
+    struct Lane
+    {
+        Descent d;
+        uint8_t key[len];
+        uint64_t value;
+        int next, end, depth;
+        uint64_t pathRefs[len];
+        uint64_t nearestRefs[len];
+        int nearestOffs[len];
+    };
+    Lane lanes[maxLanes];
+    uint16_t order[window];
+
+    for (uint64_t begin = 0; begin < n; begin += window) {
+        int size = (int) std::min((uint64_t) window, n - begin);
+        uint64_t* windowValues = values + begin;
+        uint64_t* windowRanks = ranks + begin;
+
+        // group the keys by their 8 leading bits that vary with one counting sort pass, which is
+        // enough for neighbouring keys to share nodes and much cheaper than a comparison sort
+        if (size <= maxLanes) {
+            std::iota(order, order + size, 0);
+        } else {
+            uint64_t lo = UINT64_MAX, hi = 0;
+            for (int j = 0; j < size; j++) {
+                lo = std::min(lo, windowValues[j]);
+                hi = std::max(hi, windowValues[j]);
+            }
+            int shift = std::max(0, (int) std::bit_width(lo ^ hi) - 8);
+            int offsets[257] = {0};
+            for (int j = 0; j < size; j++) {
+                offsets[((windowValues[j] >> shift) & 0xFF) + 1]++;
             }
-            // check if there's a smaller key in the leaf
-            if (amt::lowestOneBit(value) < bitPosLeaf) {
-                // NOTE: the return value is a bitMap instead of a partial sum
-                uint64_t maskedLeaf = predecessor(idx, key, off, len);
-                //int numChildren = std::popcount(bitMap);
-                //int child = std::popcount(maskedLeaf);
-                //return mem[(int) idx + numChildren] + child - 1;
-                // compute the partial sum
-                int numChildren = std::popcount(bitMap);
-                uint64_t sum = mem[(int) nodeRef + 1 + numChildren];
-                for (nodeRef = nodeRef + 1; nodeRef < idx; nodeRef++) {
-                    sum += std::popcount(mem[(int) nodeRef]);
+            for (int j = 1; j < 257; j++) {
+                offsets[j] += offsets[j - 1];
+            }
+            for (int j = 0; j < size; j++) {
+                order[offsets[(windowValues[j] >> shift) & 0xFF]++] = j;
+            }
+        }
+
+        // starts a lane's next key from the deepest node its previous key shares with it
+        auto start = [&](Lane& lane) {
+            uint64_t value = windowValues[order[lane.next]];
+            uint64_t diff = value ^ lane.value;
+            int shared = (diff == 0) ? len : (6 * len - std::bit_width(diff)) / 6;
+            int off = std::min(shared, lane.depth);
+            lane.value = value;
+            key_codec::set(lane.key, value);
+            lane.d = {lane.key, value, lane.pathRefs[off], off, lane.nearestRefs[off], lane.nearestOffs[off]};
+        };
+
+        // each lane answers a contiguous run of the grouped keys
+        int numLanes = std::min(maxLanes, size);
+        int active = numLanes;
+        for (int l = 0; l < numLanes; l++) {
+            Lane& lane = lanes[l];
+            lane.next = size * l / numLanes;
+            lane.end = size * (l + 1) / numLanes;
+            lane.value = 0;
+            lane.depth = 0;
+            lane.pathRefs[0] = root;
+            lane.nearestRefs[0] = CompressedSumSet<key_codec>::KNOWN_EMPTY_NODE;
+            lane.nearestOffs[0] = 0;
+            start(lane);
+        }
+
+        // move each lane down one node at a time so their memory accesses overlap
+        uint64_t rank;
+        while (active > 0) {
+            for (int l = 0; l < numLanes; l++) {
+                Lane& lane = lanes[l];
+                if (lane.next == lane.end) continue;
+                Descent& d = lane.d;
+                lane.pathRefs[d.off] = d.nodeRef;
+                lane.nearestRefs[d.off] = d.nearestNodeRef;
+                lane.nearestOffs[d.off] = d.nearestOff;
+                lane.depth = d.off;
+                if (descend(d, rank)) {
+                    windowValues[order[lane.next]] = key_codec::get(lane.key);
+                    windowRanks[order[lane.next]] = rank;
+                    if (++lane.next == lane.end) {
+                        active--;
+                        continue;
+                    }
+                    start(lane);
                 }
-                return sum + std::popcount(maskedLeaf);
+                __builtin_prefetch(mem + (d.nodeRef & ~CompressedSumSet<key_codec>::TAIL_FLAG));
             }
-            // go back to the last node with a bit before the matched bit
-            return predecessor(nearestNodeRef, key, nearestOff, len);
-        // value is a nodeRef
-        } else {
-            nodeRef = value;
         }
     }
 }
 
-uint64_t CompressedSumSet::predecessor(uint64_t nodeRef, uint8_t* key, int off, int len) {
+template <class key_codec>
+uint64_t CompressedSumSet<key_codec>::predecessor(uint64_t nodeRef, uint8_t* key, int off, int len) {
     // no smaller key exists
-    if (nodeRef == CompressedSumSet::KNOWN_EMPTY_NODE) {
+    if (nodeRef == CompressedSumSet<key_codec>::KNOWN_EMPTY_NODE) {
         throw std::runtime_error("No key to select");
     }
 
-    uint64_t bitMap = mem[(int) nodeRef];
+    uint64_t bitMap = mem[nodeRef];
     uint64_t bitPos = ((uint64_t) 1) << key[off];
 
     // get the largest key that is less than the given key
@@ -364,52 +494,44 @@ uint64_t CompressedSumSet::predecessor(uint64_t nodeRef, uint8_t* key, int off,
         return maskedBitMap;
     }
 
-    // get the largest key in all remaining nodes
+    // get the largest key in all remaining nodes; leaf parents store the partial sum before the leafs
     bitPos = ((uint64_t) 1) << key[off++];  // mind the ++
-    uint64_t idx = nodeRef + 1 + std::popcount(bitMap & (bitPos - 1));
-    uint64_t nextNodeRef = mem[(int) idx];
+    uint64_t idx = nodeRef + ((off == len - 1) ? 2 : 1) + std::popcount(bitMap & (bitPos - 1));
+    uint64_t nextNodeRef = mem[idx];
     while (off < len - 1) {
-        bitMap = mem[(int) nextNodeRef];
-
-        // check if the node is tail compressed
-        if (compressed[(int) nextNodeRef]) {
-            setKey(key, bitMap);
-            return mem[(int) nextNodeRef + 1];
+        // check if the node is tail compressed before reading it
+        if ((nextNodeRef & CompressedSumSet<key_codec>::TAIL_FLAG) != 0) {
+            nextNodeRef ^= CompressedSumSet<key_codec>::TAIL_FLAG;
+            key_codec::set(key, mem[nextNodeRef]);
+            return mem[nextNodeRef + 1] + 1;
         }
 
+        bitMap = mem[nextNodeRef];
         key[off] = largestKey(bitMap);
         bitPos = ((uint64_t) 1) << key[off++];  // mind the ++
-        idx = nextNodeRef + 1 + std::popcount(bitMap & (bitPos - 1));
+        idx = nextNodeRef + ((off == len - 1) ? 2 : 1) + std::popcount(bitMap & (bitPos - 1));
         nodeRef = nextNodeRef;
-        nextNodeRef = mem[(int) idx];
+        nextNodeRef = mem[idx];
     }
     // at leaf
     key[off] = largestKey(nextNodeRef);
-    // compute the partial sum
-    int numChildren = std::popcount(bitMap);
-    uint64_t sum = mem[(int) nodeRef + 1 + numChildren];
-    for (nodeRef = nodeRef + 1; nodeRef <= idx; nodeRef++) {
-        sum += std::popcount(mem[(int) nodeRef]);
-    }
-    return sum;
-    //int child = std::popcount(nextNodeRef);
-    //return mem[(int) idx + numChildren] + child - 1;
+    return leafRank(nodeRef, idx - nodeRef - 2) + std::popcount(nextNodeRef);
 }
 
 /*
 bool CompressedSumSet::successor(uint8_t* key, int len) {
-    if (root == CompressedSumSet::KNOWN_EMPTY_NODE) {
+    if (root == CompressedSumSet<key_codec>::KNOWN_EMPTY_NODE) {
         return false;
     }
 
     uint64_t nodeRef = root;
     int off = 0;
 
-    uint64_t nearestNodeRef = CompressedSumSet::KNOWN_EMPTY_NODE;
+    uint64_t nearestNodeRef = CompressedSumSet<key_codec>::KNOWN_EMPTY_NODE;
     int nearestOff = 0;
 
     for (;;) {
-        uint64_t bitMap = mem[(int) nodeRef];
+        uint64_t bitMap = mem[nodeRef];
         uint64_t bitPos = ((uint64_t) 1) << key[off];
 
         // memoize the node if it has larger keys
@@ -424,7 +546,7 @@ bool CompressedSumSet::successor(uint8_t* key, int len) {
         }
 
         uint64_t idx = nodeRef + 1 + std::popcount(bitMap & (bitPos - 1));
-        uint64_t value = mem[(int) idx];
+        uint64_t value = mem[idx];
 
         if (++off == len - 1) {
             // at leaf
@@ -450,11 +572,11 @@ bool CompressedSumSet::successor(uint8_t* key, int len) {
 /*
 bool CompressedSumSet::successor(uint64_t nodeRef, uint8_t* key, int off, int len) {
     // no smaller key exists
-    if (nodeRef == CompressedSumSet::KNOWN_EMPTY_NODE) {
+    if (nodeRef == CompressedSumSet<key_codec>::KNOWN_EMPTY_NODE) {
         return false;
     }
 
-    uint64_t bitMap = mem[(int) nodeRef];
+    uint64_t bitMap = mem[nodeRef];
     uint64_t bitPos = ((uint64_t) 1) << (key[off] + 1);  // +1 because bitMap is exclusive
 
     // get the smallest key that is greater than the given key
@@ -468,12 +590,12 @@ bool CompressedSumSet::successor(uint64_t nodeRef, uint8_t* key, int off, int le
     }
 
     // get the smallest key in all remaining nodes
-    nodeRef = mem[(int) nodeRef + 1 + std::popcount(bitMap & (bitPos - 1))];
+    nodeRef = mem[nodeRef + 1 + std::popcount(bitMap & (bitPos - 1))];
     while (off < len - 1) {
-        bitMap = mem[(int) nodeRef];
+        bitMap = mem[nodeRef];
         key[off] = smallestKey(bitMap);
         bitPos = ((uint64_t) 1) << key[off++];  // mind the ++
-        nodeRef = mem[(int) nodeRef + 1 + std::popcount(bitMap & (bitPos - 1))];
+        nodeRef = mem[nodeRef + 1 + std::popcount(bitMap & (bitPos - 1))];
     }
     // at leaf
     key[off] = smallestKey(nodeRef);
@@ -482,4 +604,21 @@ bool CompressedSumSet::successor(uint64_t nodeRef, uint8_t* key, int off, int le
 }
 */
 
+// serialization
+
+template <class key_codec>
+void CompressedSumSet<key_codec>::save(std::string filename) {
+    saveFile(filename, [this](std::ostream& out) {
+        uint64_t header[CompressedSumSet<key_codec>::SAVED_HEADER_SIZE] = {
+            CompressedSumSet<key_codec>::MAGIC, (uint64_t) key_codec::LENGTH, leafCounts, root, count,
+            numWords, nodeCount, sumCount, leafCountCount, padCount, source
+        };
+        out.write((const char*) header, sizeof(header));
+        out.write((const char*) mem, numWords * sizeof(uint64_t));
+    });
+}
+
+template class CompressedSumSet<Key6>;
+template class CompressedSumSet<Key11>;
+
 }
@@ -0,0 +1,180 @@
+#include <algorithm>
+#include <bit>
+#include <cstdlib>  // aligned_alloc, free
+#include <stdexcept>
+#include <vector>
+#include "amt/bitops.hpp"
+#include "amt/key.hpp"
+#include "amt/level_order_sum_set.hpp"
+
+namespace amt {
+
+// construction
+
+template <class key_codec, int block_words>
+LevelOrderSumSet<key_codec, block_words>::LevelOrderSumSet(KeyStream keys) {
+    const int len = key_codec::LENGTH;
+    const int nodesPerBlock = LevelOrderSumSet<key_codec, block_words>::NODES_PER_BLOCK;
+    // count the nodes in each level and lay the levels out one after another in whole blocks
+    mem = nullptr;
+    construct(keys(), false);
+    numWords = 0;
+    for (int level = 0; level < len; level++) {
+        levelRefs[level] = numWords;
+        numWords += (levelSizes[level] + nodesPerBlock - 1) / nodesPerBlock * block_words;
+    }
+    // allocate the memory aligned to cache lines so the blocks line up with them
+    uint64_t lineBytes = 64;
+    uint64_t bytes = (numWords * sizeof(uint64_t) + lineBytes - 1) / lineBytes * lineBytes;
+    mem = (uint64_t*) std::aligned_alloc(lineBytes, std::max(bytes, lineBytes));
+    if (mem == nullptr) {
+        throw std::runtime_error("failed to allocate the set");
+    }
+    std::fill(mem, mem + numWords, 0);
+    construct(keys(), true);
+
+    // count the bits set before each block
+    for (int level = 0; level < len; level++) {
+        uint64_t sum = 0;
+        uint64_t* end = mem + levelRefs[level] + (levelSizes[level] + nodesPerBlock - 1) / nodesPerBlock * block_words;
+        for (uint64_t* block = mem + levelRefs[level]; block < end; block += block_words) {
+            block[0] = sum;
+            sum += popcountSum(block + 1, nodesPerBlock);
+        }
+    }
+}
+
+template <class key_codec, int block_words>
+void LevelOrderSumSet<key_codec, block_words>::construct(Set::NextKey nextKey, bool fill) {
+    const int len = key_codec::LENGTH;
+    // the node being built at each level and the number of nodes finished in each level; a node
+    // stays open until a key with a different prefix arrives, and since the keys are sorted the
+    // nodes of a level are finished from left to right
+    std::vector<uint64_t> bitMaps(len, 0);
+    std::vector<uint64_t> numNodes(len, 0);
+    std::vector<uint8_t> previous(len), key(len);
+    int p, d;
+
+    count = 0;
+
+    auto writeNode = [&](int level) {
+        if (fill) {
+            bitMap(level, numNodes[level]) = bitMaps[level];
+        }
+        numNodes[level]++;
+        bitMaps[level] = 0;
+    };
+
+    if (nextKey(previous.data())) {
+        for (d = 0; d < len; d++) {
+            bitMaps[d] = ((uint64_t) 1) << previous[d];
+        }
+        count = 1;
+        while (nextKey(key.data())) {
+            for (p = 0; p < len && key[p] == previous[p]; p++);
+            // duplicate key
+            if (p == len) continue;
+            if (key[p] < previous[p]) {
+                throw std::runtime_error("keys must be in ascending order");
+            }
+            // the nodes below the level the key differs at have all their keys
+            for (d = len - 1; d > p; d--) {
+                writeNode(d);
+            }
+            for (d = p; d < len; d++) {
+                bitMaps[d] |= ((uint64_t) 1) << key[d];
+            }
+            std::copy(key.begin(), key.end(), previous.begin());
+            count++;
+        }
+        // close all the levels, including the root
+        for (d = len - 1; d >= 0; d--) {
+            writeNode(d);
+        }
+    }
+
+    std::copy(numNodes.begin(), numNodes.end(), levelSizes);
+}
+
+// destruction
+
+template <class key_codec, int block_words>
+LevelOrderSumSet<key_codec, block_words>::~LevelOrderSumSet() {
+    std::free(mem);
+}
+
+// private
+
+template <class key_codec, int block_words>
+uint64_t& LevelOrderSumSet<key_codec, block_words>::bitMap(int level, uint64_t node) {
+    const int nodesPerBlock = LevelOrderSumSet<key_codec, block_words>::NODES_PER_BLOCK;
+    return mem[levelRefs[level] + node / nodesPerBlock * block_words + 1 + node % nodesPerBlock];
+}
+
+template <class key_codec, int block_words>
+uint64_t LevelOrderSumSet<key_codec, block_words>::rank(int level, uint64_t node, uint64_t bitPos) {
+    const int nodesPerBlock = LevelOrderSumSet<key_codec, block_words>::NODES_PER_BLOCK;
+    const uint64_t* block = mem + levelRefs[level] + node / nodesPerBlock * block_words;
+    int offset = node % nodesPerBlock;
+    return block[0] + popcountSum(block + 1, offset) + std::popcount(block[1 + offset] & (bitPos - 1));
+}
+
+// set operations
+
+template <class key_codec, int block_words>
+uint64_t LevelOrderSumSet<key_codec, block_words>::predecessor(uint8_t* key) {
+    const int len = key_codec::LENGTH;
+    if (count == 0) {
+        throw std::runtime_error("No key to select");
+    }
+
+    uint64_t node = 0;
+    int nearestLevel = -1;
+    uint64_t nearestNode = 0;
+    for (int level = 0; level < len; level++) {
+        uint64_t bits = bitMap(level, node);
+        uint64_t bitPos = ((uint64_t) 1) << key[level];
+
+        // memoize the node if it has smaller keys
+        if (amt::lowestOneBit(bits) < bitPos) {
+            nearestLevel = level;
+            nearestNode = node;
+        }
+
+        // key not found
+        if ((bits & bitPos) == 0) break;
+
+        // the index of the child in the next level or, in the last level, the number of keys less
+        // than the key
+        node = rank(level, node, bitPos);
+        if (level == len - 1) {
+            return node;
+        }
+    }
+
+    // no smaller key exists
+    if (nearestLevel == -1) {
+        throw std::runtime_error("No key to select");
+    }
+
+    // get the largest key that is less than the given key by going back to the last node with a
+    // bit before the matched bit and following its largest keys
+    node = nearestNode;
+    uint64_t bits = bitMap(nearestLevel, node) & ((((uint64_t) 1) << key[nearestLevel]) - 1);
+    for (int level = nearestLevel;; level++) {
+        key[level] = largestKey(bits);
+        node = rank(level, node, ((uint64_t) 1) << key[level]);
+        // the selected key is less than the given key too
+        if (level == len - 1) {
+            return node + 1;
+        }
+        bits = bitMap(level + 1, node);
+    }
+}
+
+template class LevelOrderSumSet<Key6>;
+template class LevelOrderSumSet<Key6, 32>;
+template class LevelOrderSumSet<Key11>;
+template class LevelOrderSumSet<Key11, 32>;
+
+}
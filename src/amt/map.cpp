@@ -1,5 +1,6 @@
 #include <algorithm>
 #include <bit>
+#include <stdexcept>
 #include "amt/bitops.hpp"
 #include "amt/key.hpp"
 #include "amt/map.hpp"
@@ -8,24 +9,33 @@ namespace amt {
 
 // construction
 
-Map::Map(int size): currentSize(size)
+Map::Map(uint64_t size, bool hugePages): mem(size, hugePages)
 {
-    mem = new uint64_t[currentSize];
+    // the header nodes are zero, i.e. empty
+    mem.allocate(Map::HEADER_SIZE);
     freeLists = new uint64_t[Map::FREE_LIST_SIZE];
     for (int i = 0; i < Map::FREE_LIST_SIZE; i++) {
         freeLists[i] = 0;
     }
-    freeIdx = Map::HEADER_SIZE;
     root = Map::KNOWN_EMPTY_NODE;
     count = 0;
     nodeCount = 0;
 }
 
+Map::Map(std::string filename, bool hugePages): file(filename, Map::MAGIC), mem(file, Map::SAVED_HEADER_SIZE, hugePages)
+{
+    uint64_t* header = file.words(0, Map::SAVED_HEADER_SIZE);
+    root = header[1];
+    count = header[2];
+    nodeCount = header[3];
+    freeLists = new uint64_t[Map::FREE_LIST_SIZE];
+    std::copy(header + 4, header + Map::SAVED_HEADER_SIZE, freeLists);
+}
+
 // destruction
 
 Map::~Map()
 {
-    delete[] mem;
     delete[] freeLists;
 }
 
@@ -36,33 +46,19 @@ uint64_t Map::allocate(int size)
     uint64_t free = freeLists[size];
     if (free != 0) {
         // requested size available in free list, re-link and return head
-        freeLists[size] = mem[(int) free];
+        freeLists[size] = mem[free];
         return free;
-    } else {
-        // expansion required?
-        if (freeIdx + size > currentSize) {
-            // increase by 25% and assure this is enough
-            int newSize = currentSize + std::max(currentSize / 4, size);
-            uint64_t* newMem = new uint64_t[newSize];
-            for (int i = 0; i < currentSize; i++) {
-                newMem[i] = mem[i];
-            }
-            delete[] mem;
-            mem = newMem;
-            currentSize = newSize;
-        }
-        uint64_t idx = freeIdx;
-        freeIdx += size;
-        return idx;
     }
+    // the arena grows by adding segments so existing nodes are never copied
+    return mem.allocate(size);
 }
 
 uint64_t Map::allocateInsert(uint64_t nodeIdx, int size, int childIdx)
 {
     uint64_t newNodeRef = allocate(size + 1);
 
-    int a = (int) newNodeRef;
-    int b = (int) nodeIdx;
+    uint64_t a = newNodeRef;
+    uint64_t b = nodeIdx;
 
     // copy with gap for child
     for (int j = 0; j < childIdx; j++) {
@@ -83,8 +79,8 @@ uint64_t Map::allocateDelete(uint64_t nodeIdx, int size, int childIdx)
     uint64_t newNodeRef = allocate(size - 1);
 
     // copy with child removed
-    int a = (int) newNodeRef;
-    int b = (int) nodeIdx;
+    uint64_t a = newNodeRef;
+    uint64_t b = nodeIdx;
     for (int j = 0; j < childIdx; j++) {
         mem[a++] = mem[b++];
     }
@@ -105,7 +101,7 @@ void Map::deallocate(uint64_t idx, int size)
     }
 
     // add to head of free-list
-    mem[(int) idx] = freeLists[size];
+    mem[idx] = freeLists[size];
     freeLists[size] = idx;
 }
 
@@ -114,14 +110,14 @@ void Map::deallocate(uint64_t idx, int size)
 uint64_t Map::createLeaf(uint8_t* key, int off, int len, uint64_t keyValue)
 {
     uint64_t newNodeRef = allocate(2);
-    int a = (int) newNodeRef;
+    uint64_t a = newNodeRef;
     mem[a++] = ((uint64_t) 1) << key[len - 1];
     mem[a] = keyValue;
     nodeCount += 2;
     len -= 2;
     while (len >= off) {
         uint64_t newParentNodeRef = allocate(2);
-        a = (int) newParentNodeRef;
+        a = newParentNodeRef;
         mem[a++] = ((uint64_t) 1) << key[len--];
         mem[a] = newNodeRef;
         nodeCount += 2;
@@ -134,8 +130,8 @@ uint64_t Map::insertChild(uint64_t nodeRef, uint64_t bitMap, uint64_t bitPos, in
 {
     int size = std::popcount(bitMap);
     uint64_t newNodeRef = allocateInsert(nodeRef, size + 1, idx + 1);
-    mem[(int) newNodeRef] = bitMap | bitPos;
-    mem[(int) newNodeRef + 1 + idx] = value;
+    mem[newNodeRef] = bitMap | bitPos;
+    mem[newNodeRef + 1 + idx] = value;
     nodeCount += 1;
     return newNodeRef;
 }
@@ -146,7 +142,7 @@ uint64_t Map::removeChild(uint64_t nodeRef, uint64_t bitMap, uint64_t bitPos, in
     if (size > 1) {
         // node still has other children / leaves
         uint64_t newNodeRef = allocateDelete(nodeRef, size + 1, idx + 1);
-        mem[(int) newNodeRef] = bitMap & ~bitPos;
+        mem[newNodeRef] = bitMap & ~bitPos;
         return newNodeRef;
     } else {
         // node is now empty, remove it
@@ -173,7 +169,7 @@ bool Map::set(uint8_t* key, int len, uint64_t keyValue)
 
 uint64_t Map::set(uint64_t nodeRef, uint8_t* key, int off, int len, uint64_t keyValue)
 {
-    uint64_t bitMap = mem[(int) nodeRef];
+    uint64_t bitMap = mem[nodeRef];
     uint64_t bitPos = ((uint64_t) 1) << key[off++];  // mind the ++
     int idx = std::popcount(bitMap & (bitPos - 1));
 
@@ -189,17 +185,17 @@ uint64_t Map::set(uint64_t nodeRef, uint8_t* key, int off, int len, uint64_t key
     } else {
         // child present
         if (off == len) {
-            mem[(int) nodeRef + 1 + idx] = keyValue;
+            mem[nodeRef + 1 + idx] = keyValue;
             return Map::KNOWN_EMPTY_NODE;
         } else {
             // not at leaf, recursion
-            uint64_t childNodeRef = mem[(int) nodeRef + 1 + idx];
+            uint64_t childNodeRef = mem[nodeRef + 1 + idx];
             uint64_t newChildNodeRef = set(childNodeRef, key, off, len, keyValue);
             if (newChildNodeRef == Map::KNOWN_EMPTY_NODE) {
                 return Map::KNOWN_EMPTY_NODE;
             }
             if (newChildNodeRef != childNodeRef) {
-                mem[(int) nodeRef + 1 + idx] = newChildNodeRef;
+                mem[nodeRef + 1 + idx] = newChildNodeRef;
             }
             return nodeRef;
         }
@@ -216,13 +212,13 @@ uint64_t Map::get(uint8_t* key, int len)
     int off = 0;
 
     for (;;) {
-        uint64_t bitMap = mem[(int) nodeRef];
+        uint64_t bitMap = mem[nodeRef];
         uint64_t bitPos = ((uint64_t) 1) << key[off++];  // mind the ++
         if ((bitMap & bitPos) == 0) {
             throw std::runtime_error("Key not found");
         }
 
-        uint64_t value = mem[(int) nodeRef + 1 + std::popcount(bitMap & (bitPos - 1))];
+        uint64_t value = mem[nodeRef + 1 + std::popcount(bitMap & (bitPos - 1))];
         if (off == len) {
             return value;
         } else {
@@ -245,7 +241,7 @@ uint64_t Map::predecessor(uint8_t* key, int len)
     int nearestOff = 0;
 
     for (;;) {
-        uint64_t bitMap = mem[(int) nodeRef];
+        uint64_t bitMap = mem[nodeRef];
         uint64_t bitPos = ((uint64_t) 1) << key[off];
 
         // memoize the node if it has smaller keys
@@ -260,7 +256,7 @@ uint64_t Map::predecessor(uint8_t* key, int len)
         }
 
         uint64_t idx = nodeRef + 1 + std::popcount(bitMap & (bitPos - 1));
-        uint64_t value = mem[(int) idx];
+        uint64_t value = mem[idx];
 
         if (++off == len) {
             // at value
@@ -279,7 +275,7 @@ uint64_t Map::predecessor(uint64_t nodeRef, uint8_t* key, int off, int len)
         throw std::runtime_error("No key to select");
     }
 
-    uint64_t bitMap = mem[(int) nodeRef];
+    uint64_t bitMap = mem[nodeRef];
     uint64_t bitPos = ((uint64_t) 1) << key[off];
 
     // get the largest key that is less than the given key
@@ -288,12 +284,12 @@ uint64_t Map::predecessor(uint64_t nodeRef, uint8_t* key, int off, int len)
     bitPos = ((uint64_t) 1) << key[off++];  // mind the ++
 
     // get the largest key in all remaining nodes
-    nodeRef = mem[(int) nodeRef + 1 + std::popcount(bitMap & (bitPos - 1))];
+    nodeRef = mem[nodeRef + 1 + std::popcount(bitMap & (bitPos - 1))];
     while (off < len) {
-        bitMap = mem[(int) nodeRef];
+        bitMap = mem[nodeRef];
         key[off] = largestKey(bitMap);
         bitPos = ((uint64_t) 1) << key[off++];  // mind the ++
-        nodeRef = mem[(int) nodeRef + 1 + std::popcount(bitMap & (bitPos - 1))];
+        nodeRef = mem[nodeRef + 1 + std::popcount(bitMap & (bitPos - 1))];
     }
 
     return nodeRef;
@@ -312,7 +308,7 @@ uint64_t Map::successor(uint8_t* key, int len)
     int nearestOff = 0;
 
     for (;;) {
-        uint64_t bitMap = mem[(int) nodeRef];
+        uint64_t bitMap = mem[nodeRef];
         uint64_t bitPos = ((uint64_t) 1) << key[off];
 
         // memoize the node if it has larger keys
@@ -327,7 +323,7 @@ uint64_t Map::successor(uint8_t* key, int len)
         }
 
         uint64_t idx = nodeRef + 1 + std::popcount(bitMap & (bitPos - 1));
-        uint64_t value = mem[(int) idx];
+        uint64_t value = mem[idx];
 
         if (++off == len) {
             // at leaf
@@ -346,7 +342,7 @@ uint64_t Map::successor(uint64_t nodeRef, uint8_t* key, int off, int len)
         throw std::runtime_error("No key to select");
     }
 
-    uint64_t bitMap = mem[(int) nodeRef];
+    uint64_t bitMap = mem[nodeRef];
     uint64_t bitPos = ((uint64_t) 1) << (key[off] + 1);  // +1 because bitMap is exclusive
 
     // get the smallest key that is greater than the given key
@@ -355,12 +351,12 @@ uint64_t Map::successor(uint64_t nodeRef, uint8_t* key, int off, int len)
     bitPos = ((uint64_t) 1) << key[off++];  // mind the ++
 
     // get the smallest key in all remaining nodes
-    nodeRef = mem[(int) nodeRef + 1 + std::popcount(bitMap & (bitPos - 1))];
+    nodeRef = mem[nodeRef + 1 + std::popcount(bitMap & (bitPos - 1))];
     while (off < len) {
-        bitMap = mem[(int) nodeRef];
+        bitMap = mem[nodeRef];
         key[off] = smallestKey(bitMap);
         bitPos = ((uint64_t) 1) << key[off++];  // mind the ++
-        nodeRef = mem[(int) nodeRef + 1 + std::popcount(bitMap & (bitPos - 1))];
+        nodeRef = mem[nodeRef + 1 + std::popcount(bitMap & (bitPos - 1))];
     }
 
     return nodeRef;
@@ -388,7 +384,7 @@ uint64_t Map::clear(uint64_t nodeRef, uint8_t* key, int off, int len)
         return Map::KNOWN_EMPTY_NODE;
     }
 
-    uint64_t bitMap = mem[(int) nodeRef];
+    uint64_t bitMap = mem[nodeRef];
     uint64_t bitPos = ((uint64_t) 1) << key[off++];  // mind the ++
     if ((bitMap & bitPos) == 0) {
         // child not present, key not found
@@ -401,7 +397,7 @@ uint64_t Map::clear(uint64_t nodeRef, uint8_t* key, int off, int len)
             return removeChild(nodeRef, bitMap, bitPos, idx);
         } else {
             // not at leaf
-            uint64_t childNodeRef = mem[(int) nodeRef + 1 + idx];
+            uint64_t childNodeRef = mem[nodeRef + 1 + idx];
             uint64_t newChildNodeRef = clear(childNodeRef, key, off, len);
             if (newChildNodeRef == Map::KNOWN_EMPTY_NODE) {
                 return Map::KNOWN_EMPTY_NODE;
@@ -410,7 +406,7 @@ uint64_t Map::clear(uint64_t nodeRef, uint8_t* key, int off, int len)
                 return removeChild(nodeRef, bitMap, bitPos, idx);
             }
             if (newChildNodeRef != childNodeRef) {
-                mem[(int) nodeRef + 1 + idx] = newChildNodeRef;
+                mem[nodeRef + 1 + idx] = newChildNodeRef;
             }
             return nodeRef;
         }
@@ -428,14 +424,14 @@ void Map::visit(MapVisitor& visitor, int len)
 
 void Map::visit(MapVisitor& visitor, int len, uint64_t nodeRef, uint8_t* key, int off)
 {
-    uint64_t bitMap = mem[(int) nodeRef];
+    uint64_t bitMap = mem[nodeRef];
     uint64_t bits = bitMap;
     while (bits != 0) {
         uint64_t bitPos = bits & -bits; bits ^= bitPos;  // get rightmost bit and clear it
         int bitNum = std::countr_zero(bitPos);
         key[off] = (uint8_t) bitNum;
 
-        uint64_t value = mem[(int) nodeRef + 1 + std::popcount(bitMap & (bitPos - 1))];
+        uint64_t value = mem[nodeRef + 1 + std::popcount(bitMap & (bitPos - 1))];
 
         if (off == len - 1) {
             visitor.visit(key, len, value);
@@ -469,14 +465,14 @@ void Map::visitRange(MapVisitor& visitor, uint32_t begin, uint32_t end, int len,
     bitMask |= bitMask - 1;
     bitMask &= ~((((uint64_t) 1) << x) - 1);
 
-    uint64_t bitMap = mem[(int) nodeRef];
+    uint64_t bitMap = mem[nodeRef];
     uint64_t bits = bitMap & bitMask;
     while (bits != 0) {
         uint64_t bitPos = bits & -bits; bits ^= bitPos;  // get rightmost bit and clear it
         uint8_t bitNum = std::countr_zero(bitPos);
         key[pos + off] = bitNum;
 
-        uint64_t value = mem[(int) nodeRef + 1 + std::popcount(bitMap & (bitPos - 1))];
+        uint64_t value = mem[nodeRef + 1 + std::popcount(bitMap & (bitPos - 1))];
 
         if (off == len - 1) {
             visitor.visit(key, len, value);
@@ -503,7 +499,7 @@ void Map::visitTails(MapTailVisitor& visitor, int len)
 
 void Map::visitTails(MapTailVisitor& visitor, int len, uint64_t nodeRef, uint8_t* key, int off, int tailLen)
 {
-    uint64_t bitMap = mem[(int) nodeRef];
+    uint64_t bitMap = mem[nodeRef];
     if (std::popcount(bitMap) > 1) {
         tailLen += 1;
     } else {
@@ -515,7 +511,7 @@ void Map::visitTails(MapTailVisitor& visitor, int len, uint64_t nodeRef, uint8_t
         int bitNum = std::countr_zero(bitPos);
         key[off] = (uint8_t) bitNum;
 
-        uint64_t value = mem[(int) nodeRef + 1 + std::popcount(bitMap & (bitPos - 1))];
+        uint64_t value = mem[nodeRef + 1 + std::popcount(bitMap & (bitPos - 1))];
 
         if (off == len - 1) {
             visitor.visit(key, len, value, tailLen);
@@ -525,4 +521,16 @@ void Map::visitTails(MapTailVisitor& visitor, int len, uint64_t nodeRef, uint8_t
     }
 }
 
+// serialization
+
+void Map::save(std::string filename)
+{
+    saveFile(filename, [this](std::ostream& out) {
+        uint64_t header[4] = {Map::MAGIC, root, count, nodeCount};
+        out.write((const char*) header, sizeof(header));
+        out.write((const char*) freeLists, Map::FREE_LIST_SIZE * sizeof(uint64_t));
+        mem.save(out);
+    });
+}
+
 }
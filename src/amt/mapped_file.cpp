@@ -0,0 +1,99 @@
+#include <cstdio>  // remove, rename
+#include <cstdlib>  // mkstemp
+#include <fcntl.h>
+#include <fstream>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "amt/mapped_file.hpp"
+
+namespace amt {
+
+// construction
+
+MappedFile::MappedFile(): mapped(nullptr), numWords(0) { }
+
+MappedFile::MappedFile(std::string filename, uint64_t magic): mapped(nullptr), numWords(0)
+{
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd == -1) {
+        throw std::runtime_error("failed to open " + filename);
+    }
+    struct stat st;
+    if (fstat(fd, &st) == -1) {
+        close(fd);
+        throw std::runtime_error("failed to stat " + filename);
+    }
+    if (st.st_size < (off_t) sizeof(uint64_t) || st.st_size % sizeof(uint64_t) != 0) {
+        close(fd);
+        throw std::runtime_error(filename + " is not a saved AMT");
+    }
+    // private and writable so a structure can be modified after it's loaded without changing the
+    // file; the mapping holds its own reference to the file
+    void* addr = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED) {
+        throw std::runtime_error("failed to map " + filename);
+    }
+    mapped = (uint64_t*) addr;
+    numWords = st.st_size / sizeof(uint64_t);
+    // a byte swapped magic number means the file was saved on a machine with a different byte order
+    if (mapped[0] != magic) {
+        munmap(mapped, numWords * sizeof(uint64_t));
+        mapped = nullptr;
+        throw std::runtime_error(filename + " is not a saved AMT of this type, version and byte order");
+    }
+}
+
+// destruction
+
+MappedFile::~MappedFile()
+{
+    if (mapped != nullptr) {
+        munmap(mapped, numWords * sizeof(uint64_t));
+    }
+}
+
+// public
+
+uint64_t* MappedFile::words(uint64_t offset, uint64_t n) const
+{
+    if (offset > numWords || n > numWords - offset) {
+        throw std::runtime_error("saved AMT is truncated");
+    }
+    return mapped + offset;
+}
+
+// saving
+
+void saveFile(std::string filename, std::function<void(std::ostream&)> write)
+{
+    // a unique name in the file's directory so concurrent saves don't write into the same file
+    std::string tmpFilename = filename + ".XXXXXX";
+    int fd = mkstemp(tmpFilename.data());
+    if (fd == -1) {
+        throw std::runtime_error("failed to create a temporary file for " + filename);
+    }
+    // mkstemp only lets the owner read the file but saved structures are shared
+    bool readable = fchmod(fd, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH) == 0;
+    close(fd);
+    std::ofstream out(tmpFilename, std::ios::binary);
+    if (!readable || !out) {
+        std::remove(tmpFilename.c_str());
+        throw std::runtime_error("failed to open " + tmpFilename);
+    }
+    try {
+        write(out);
+        out.close();
+    } catch (...) {
+        std::remove(tmpFilename.c_str());
+        throw;
+    }
+    if (!out || std::rename(tmpFilename.c_str(), filename.c_str()) != 0) {
+        std::remove(tmpFilename.c_str());
+        throw std::runtime_error("failed to save " + filename);
+    }
+}
+
+}
@@ -1,5 +1,7 @@
 #include <algorithm>
 #include <bit>
+#include <stdexcept>
+#include <vector>
 #include "amt/bitops.hpp"
 #include "amt/key.hpp"
 #include "amt/set.hpp"
@@ -10,7 +12,7 @@ namespace amt {
 
 void Set::tmp(uint64_t nodeRef, uint8_t* key, int off, int len)
 {
-    uint64_t bitMap = mem[(int) nodeRef];
+    uint64_t bitMap = mem[nodeRef];
     if (bitMap == 0) {
         return;
     }
@@ -20,7 +22,7 @@ void Set::tmp(uint64_t nodeRef, uint8_t* key, int off, int len)
         int bitNum = std::countr_zero(bitPos);
         key[off] = (uint8_t) bitNum;
         if (off == len - 2) {
-            uint64_t value = mem[(int) nodeRef + 1 + std::popcount(bitMap & (bitPos - 1))];
+            uint64_t value = mem[nodeRef + 1 + std::popcount(bitMap & (bitPos - 1))];
             uint64_t bits2 = value;
             while (bits2 != 0) {
                 uint64_t bitPos2 = bits2 & -bits2; bits2 ^= bitPos2;
@@ -29,7 +31,7 @@ void Set::tmp(uint64_t nodeRef, uint8_t* key, int off, int len)
                 std::cerr << "key: " << get6Int(key) << std::endl;
             }
         } else {
-            uint64_t childNode = mem[(int) nodeRef + 1 + std::popcount(bitMap & (bitPos - 1))];
+            uint64_t childNode = mem[nodeRef + 1 + std::popcount(bitMap & (bitPos - 1))];
             tmp(childNode, key, off + 1, len);
         }
     }
@@ -37,24 +39,94 @@ void Set::tmp(uint64_t nodeRef, uint8_t* key, int off, int len)
 
 // construction
 
-Set::Set(int size): currentSize(size) {
-    mem = new uint64_t[currentSize];
-    for (int i = 0; i < currentSize; i++) {
-        mem[i] = 0;
-    }
+Set::Set(uint64_t size, bool hugePages): mem(size, hugePages) {
+    // the header nodes are zero, i.e. empty
+    mem.allocate(Set::HEADER_SIZE);
     freeLists = new uint64_t[Set::FREE_LIST_SIZE];
     for (int i = 0; i < Set::FREE_LIST_SIZE; i++) {
         freeLists[i] = 0;
     }
-    freeIdx = Set::HEADER_SIZE;
     root = Set::KNOWN_EMPTY_NODE;
     count = 0;
 }
 
+Set::Set(NextKey nextKey, int len, bool hugePages): Set(0, hugePages) {
+    bulkLoad(nextKey, len);
+}
+
+Set::Set(std::string filename, bool hugePages): file(filename, Set::MAGIC), mem(file, Set::SAVED_HEADER_SIZE, hugePages) {
+    uint64_t* header = file.words(0, Set::SAVED_HEADER_SIZE);
+    root = header[1];
+    count = header[2];
+    freeLists = new uint64_t[Set::FREE_LIST_SIZE];
+    std::copy(header + 3, header + Set::SAVED_HEADER_SIZE, freeLists);
+}
+
+void Set::bulkLoad(NextKey nextKey, int len) {
+    // the node being built at each level, except the leaves, and the children it has so far; a
+    // node's last child stays open until a key with a different prefix arrives
+    std::vector<uint64_t> bitMaps(len - 1, 0);
+    std::vector<uint64_t> children((len - 1) * 64);
+    std::vector<uint8_t> previous(len), key(len);
+    uint64_t leaf = 0, child;
+    int p, d;
+
+    // closes the levels below the given one, adding each finished node to its parent
+    auto close = [&](int level) {
+        child = leaf;
+        for (d = len - 2; d > level; d--) {
+            bitMaps[d] |= ((uint64_t) 1) << previous[d];
+            children[d * 64 + std::popcount(bitMaps[d]) - 1] = child;
+            child = writeNode(bitMaps[d], children.data() + d * 64);
+            bitMaps[d] = 0;
+        }
+        bitMaps[level] |= ((uint64_t) 1) << previous[level];
+        children[level * 64 + std::popcount(bitMaps[level]) - 1] = child;
+    };
+
+    if (!nextKey(previous.data())) {
+        return;
+    }
+    leaf = ((uint64_t) 1) << previous[len - 1];
+    count = 1;
+    while (nextKey(key.data())) {
+        for (p = 0; p < len && key[p] == previous[p]; p++);
+        // duplicate key
+        if (p == len) continue;
+        if (key[p] < previous[p]) {
+            throw std::runtime_error("bulk loaded keys must be in ascending order");
+        }
+        count++;
+        // the key is in the open leaf
+        if (p == len - 1) {
+            // later keys are compared to this one, so repeats of it are caught
+            previous[len - 1] = key[len - 1];
+            leaf |= ((uint64_t) 1) << key[len - 1];
+            continue;
+        }
+        close(p);
+        std::copy(key.begin(), key.end(), previous.begin());
+        leaf = ((uint64_t) 1) << key[len - 1];
+    }
+
+    // close all the levels and the root
+    close(0);
+    root = writeNode(bitMaps[0], children.data());
+}
+
+uint64_t Set::writeNode(uint64_t bitMap, uint64_t* children) {
+    int size = std::popcount(bitMap);
+    uint64_t nodeRef = allocate(size + 1);
+    mem[nodeRef] = bitMap;
+    for (int i = 0; i < size; i++) {
+        mem[nodeRef + 1 + i] = children[i];
+    }
+    return nodeRef;
+}
+
 // destruction
 
 Set::~Set() {
-    delete[] mem;
     delete[] freeLists;
 }
 
@@ -64,35 +136,18 @@ uint64_t Set::allocate(int size) {
     uint64_t free = freeLists[size];
     if (free != 0) {
         // requested size available in free list, re-link and return head
-        freeLists[size] = mem[(int) free];
+        freeLists[size] = mem[free];
         return free;
-    } else {
-        // expansion required?
-        if (freeIdx + size > currentSize) {
-            // increase by 25% and assure this is enough
-            int newSize = currentSize + std::max(currentSize / 4, size);
-            uint64_t* newMem = new uint64_t[newSize];
-            for (int i = 0; i < currentSize; i++) {
-                newMem[i] = mem[i];
-            }
-            for (int i = currentSize; i < newSize; i++) {
-                newMem[i] = 0;
-            }
-            delete[] mem;
-            mem = newMem;
-            currentSize = newSize;
-        }
-        uint64_t idx = freeIdx;
-        freeIdx += size;
-        return idx;
     }
+    // the arena grows by adding segments so existing nodes are never copied
+    return mem.allocate(size);
 }
 
 uint64_t Set::allocateInsert(uint64_t nodeIdx, int size, int childIdx) {
     uint64_t newNodeRef = allocate(size + 1);
 
-    int a = (int) newNodeRef;
-    int b = (int) nodeIdx;
+    uint64_t a = newNodeRef;
+    uint64_t b = nodeIdx;
 
     // copy with gap for child
     for (int j = 0; j < childIdx; j++) {
@@ -112,8 +167,8 @@ uint64_t Set::allocateDelete(uint64_t nodeIdx, int size, int childIdx) {
     uint64_t newNodeRef = allocate(size - 1);
 
     // copy with child removed
-    int a = (int) newNodeRef;
-    int b = (int) nodeIdx;
+    uint64_t a = newNodeRef;
+    uint64_t b = nodeIdx;
     for (int j = 0; j < childIdx; j++) {
         mem[a++] = mem[b++];
     }
@@ -133,7 +188,7 @@ void Set::deallocate(uint64_t idx, int size) {
     }
 
     // add to head of free-list
-    mem[(int) idx] = freeLists[size];
+    mem[idx] = freeLists[size];
     freeLists[size] = idx;
 }
 
@@ -141,13 +196,13 @@ void Set::deallocate(uint64_t idx, int size) {
 
 uint64_t Set::createLeaf(uint8_t* key, int off, int len) {
     uint64_t newNodeRef = allocate(2);
-    int a = (int) newNodeRef;
+    uint64_t a = newNodeRef;
     mem[a++] = ((uint64_t) 1) << key[len - 2];
     mem[a] = ((uint64_t) 1) << key[len - 1];  // value
     len -= 3;
     while (len >= off) {
         uint64_t newParentNodeRef = allocate(2);
-        a = (int) newParentNodeRef;
+        a = newParentNodeRef;
         mem[a++] = ((uint64_t) 1) << key[len--];
         mem[a] = newNodeRef;
         newNodeRef = newParentNodeRef;
@@ -158,8 +213,8 @@ uint64_t Set::createLeaf(uint8_t* key, int off, int len) {
 uint64_t Set::insertChild(uint64_t nodeRef, uint64_t bitMap, uint64_t bitPos, int idx, uint64_t value) {
     int size = std::popcount(bitMap);
     uint64_t newNodeRef = allocateInsert(nodeRef, size + 1, idx + 1);
-    mem[(int) newNodeRef] = bitMap | bitPos;
-    mem[(int) newNodeRef + 1 + idx] = value;
+    mem[newNodeRef] = bitMap | bitPos;
+    mem[newNodeRef + 1 + idx] = value;
     return newNodeRef;
 }
 
@@ -168,7 +223,7 @@ uint64_t Set::removeChild(uint64_t nodeRef, uint64_t bitMap, uint64_t bitPos, in
     if (size > 1) {
         // node still has other children / leaves
         uint64_t newNodeRef = allocateDelete(nodeRef, size + 1, idx + 1);
-        mem[(int) newNodeRef] = bitMap & ~bitPos;
+        mem[newNodeRef] = bitMap & ~bitPos;
         return newNodeRef;
     } else {
         // node is now empty, remove it
@@ -192,7 +247,7 @@ bool Set::set(uint8_t* key, int len) {
 }
 
 uint64_t Set::set(uint64_t nodeRef, uint8_t* key, int off, int len) {
-    uint64_t bitMap = mem[(int) nodeRef];
+    uint64_t bitMap = mem[nodeRef];
     uint64_t bitPos = ((uint64_t) 1) << key[off++];  // mind the ++
     int idx = std::popcount(bitMap & (bitPos - 1));
 
@@ -207,13 +262,13 @@ uint64_t Set::set(uint64_t nodeRef, uint8_t* key, int off, int len) {
         return insertChild(nodeRef, bitMap, bitPos, idx, value);
     } else {
         // child present
-        uint64_t value = mem[(int) nodeRef + 1 + idx];
+        uint64_t value = mem[nodeRef + 1 + idx];
         if (off == len - 1) {
             // at leaf
             uint64_t bitPosLeaf = ((uint64_t) 1) << key[off];
             if ((value & bitPosLeaf) == 0) {
                 // update leaf bitMap
-                mem[(int) nodeRef + 1 + idx] = value | bitPosLeaf;
+                mem[nodeRef + 1 + idx] = value | bitPosLeaf;
                 return nodeRef;
             } else {
                 // key already present
@@ -227,7 +282,7 @@ uint64_t Set::set(uint64_t nodeRef, uint8_t* key, int off, int len) {
                 return Set::KNOWN_EMPTY_NODE;
             }
             if (newChildNodeRef != childNodeRef) {
-                mem[(int) nodeRef + 1 + idx] = newChildNodeRef;
+                mem[nodeRef + 1 + idx] = newChildNodeRef;
             }
             return nodeRef;
         }
@@ -243,13 +298,13 @@ bool Set::get(uint8_t* key, int len) {
     int off = 0;
 
     for (;;) {
-        uint64_t bitMap = mem[(int) nodeRef];
+        uint64_t bitMap = mem[nodeRef];
         uint64_t bitPos = ((uint64_t) 1) << key[off++]; // mind the ++
         if ((bitMap & bitPos) == 0) {
             return false; // not found
         }
 
-        uint64_t value = mem[(int) nodeRef + 1 + std::popcount(bitMap & (bitPos - 1))];
+        uint64_t value = mem[nodeRef + 1 + std::popcount(bitMap & (bitPos - 1))];
 
         if (off == len - 1) {
             // at leaf
@@ -274,7 +329,7 @@ bool Set::predecessor(uint8_t* key, int len) {
     int nearestOff = 0;
 
     for (;;) {
-        uint64_t bitMap = mem[(int) nodeRef];
+        uint64_t bitMap = mem[nodeRef];
         uint64_t bitPos = ((uint64_t) 1) << key[off];
 
         // memoize the node if it has smaller keys
@@ -289,7 +344,7 @@ bool Set::predecessor(uint8_t* key, int len) {
         }
 
         uint64_t idx = nodeRef + 1 + std::popcount(bitMap & (bitPos - 1));
-        uint64_t value = mem[(int) idx];
+        uint64_t value = mem[idx];
 
         if (++off == len - 1) {
             // at leaf
@@ -317,13 +372,13 @@ bool Set::predecessor(uint64_t nodeRef, uint8_t* key, int off, int len) {
         return false;
     }
 
-    uint64_t bitMap = mem[(int) nodeRef];
+    uint64_t bitMap = mem[nodeRef];
     uint64_t bitPos = ((uint64_t) 1) << key[off];
 
     // get the largest key that is less than the given key
     uint64_t maskedBitMap = bitMap & (bitPos - 1);
     key[off] = largestKey(maskedBitMap);
-    bitPos = ((uint64_t) 1) << key[off++];  // mind the ++
+    bitPos = ((uint64_t) 1) << key[off];
 
     // nodeRef is a leaf node
     if (off++ == len - 1) {  // mind the ++
@@ -331,12 +386,12 @@ bool Set::predecessor(uint64_t nodeRef, uint8_t* key, int off, int len) {
     }
 
     // get the largest key in all remaining nodes
-    nodeRef = mem[(int) nodeRef + 1 + std::popcount(bitMap & (bitPos - 1))];
+    nodeRef = mem[nodeRef + 1 + std::popcount(bitMap & (bitPos - 1))];
     while (off < len - 1) {
-        bitMap = mem[(int) nodeRef];
+        bitMap = mem[nodeRef];
         key[off] = largestKey(bitMap);
         bitPos = ((uint64_t) 1) << key[off++];  // mind the ++
-        nodeRef = mem[(int) nodeRef + 1 + std::popcount(bitMap & (bitPos - 1))];
+        nodeRef = mem[nodeRef + 1 + std::popcount(bitMap & (bitPos - 1))];
     }
     // at leaf
     key[off] = largestKey(nodeRef);
@@ -356,7 +411,7 @@ bool Set::successor(uint8_t* key, int len) {
     int nearestOff = 0;
 
     for (;;) {
-        uint64_t bitMap = mem[(int) nodeRef];
+        uint64_t bitMap = mem[nodeRef];
         uint64_t bitPos = ((uint64_t) 1) << key[off];
 
         // memoize the node if it has larger keys
@@ -371,7 +426,7 @@ bool Set::successor(uint8_t* key, int len) {
         }
 
         uint64_t idx = nodeRef + 1 + std::popcount(bitMap & (bitPos - 1));
-        uint64_t value = mem[(int) idx];
+        uint64_t value = mem[idx];
 
         if (++off == len - 1) {
             // at leaf
@@ -399,7 +454,7 @@ bool Set::successor(uint64_t nodeRef, uint8_t* key, int off, int len) {
         return false;
     }
 
-    uint64_t bitMap = mem[(int) nodeRef];
+    uint64_t bitMap = mem[nodeRef];
     uint64_t bitPos = ((uint64_t) 1) << (key[off] + 1);  // +1 because bitMap is exclusive
 
     // get the smallest key that is greater than the given key
@@ -413,12 +468,12 @@ bool Set::successor(uint64_t nodeRef, uint8_t* key, int off, int len) {
     }
 
     // get the smallest key in all remaining nodes
-    nodeRef = mem[(int) nodeRef + 1 + std::popcount(bitMap & (bitPos - 1))];
+    nodeRef = mem[nodeRef + 1 + std::popcount(bitMap & (bitPos - 1))];
     while (off < len - 1) {
-        bitMap = mem[(int) nodeRef];
+        bitMap = mem[nodeRef];
         key[off] = smallestKey(bitMap);
         bitPos = ((uint64_t) 1) << key[off++];  // mind the ++
-        nodeRef = mem[(int) nodeRef + 1 + std::popcount(bitMap & (bitPos - 1))];
+        nodeRef = mem[nodeRef + 1 + std::popcount(bitMap & (bitPos - 1))];
     }
     // at leaf
     key[off] = smallestKey(nodeRef);
@@ -446,7 +501,7 @@ uint64_t Set::clear(uint64_t nodeRef, uint8_t* key, int off, int len) {
         return Set::KNOWN_EMPTY_NODE;
     }
 
-    uint64_t bitMap = mem[(int) nodeRef];
+    uint64_t bitMap = mem[nodeRef];
     uint64_t bitPos = ((uint64_t) 1) << key[off++];  // mind the ++
     if ((bitMap & bitPos) == 0) {
         // child not present, key not found
@@ -454,7 +509,7 @@ uint64_t Set::clear(uint64_t nodeRef, uint8_t* key, int off, int len) {
     } else {
         // child present
         int idx = std::popcount(bitMap & (bitPos - 1));
-        uint64_t value = mem[(int) nodeRef + 1 + idx];
+        uint64_t value = mem[nodeRef + 1 + idx];
         if (off == len - 1) {
             // at leaf
             uint64_t bitPosLeaf = ((uint64_t) 1) << key[off];
@@ -466,7 +521,7 @@ uint64_t Set::clear(uint64_t nodeRef, uint8_t* key, int off, int len) {
                 value = value & ~bitPosLeaf;
                 if (value != 0) {
                     // leaf still has some bits set, keep leaf but update
-                    mem[(int) nodeRef + 1 + idx] = value;
+                    mem[nodeRef + 1 + idx] = value;
                     return nodeRef;
                 } else {
                     return removeChild(nodeRef, bitMap, bitPosLeaf, idx);
@@ -483,11 +538,22 @@ uint64_t Set::clear(uint64_t nodeRef, uint8_t* key, int off, int len) {
                 return removeChild(nodeRef, bitMap, bitPos, idx);
             }
             if (newChildNodeRef != childNodeRef) {
-                mem[(int) nodeRef + 1 + idx] = newChildNodeRef;
+                mem[nodeRef + 1 + idx] = newChildNodeRef;
             }
             return nodeRef;
         }
     }
 }
 
+// serialization
+
+void Set::save(std::string filename) {
+    saveFile(filename, [this](std::ostream& out) {
+        uint64_t header[3] = {Set::MAGIC, root, count};
+        out.write((const char*) header, sizeof(header));
+        out.write((const char*) freeLists, Set::FREE_LIST_SIZE * sizeof(uint64_t));
+        mem.save(out);
+    });
+}
+
 }
@@ -0,0 +1,141 @@
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <sys/resource.h>
+#include <vector>
+#include "amt/key.hpp"
+#include "amt/map.hpp"
+#include "amt/set.hpp"
+#include "bench/bench.hpp"
+
+namespace bench {
+
+/**
+ * Times inserting keys into a Set or Map and prints the throughput and the memory reserved.
+ */
+template <class Trie, class Insert>
+void timeInserts(std::string name, const std::vector<uint32_t>& keys, bool hugePages, Insert insert)
+{
+    uint8_t key[6];
+    auto startTime = std::chrono::steady_clock::now();
+    Trie trie(1024, hugePages);
+    for (uint32_t k : keys) {
+        amt::set6Int(key, k);
+        insert(trie, key, k);
+    }
+    auto endTime = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration_cast<std::chrono::nanoseconds>(endTime - startTime).count() / 1e9;
+
+    // check the keys were all added
+    for (uint32_t k : keys) {
+        amt::set6Int(key, k);
+        uint8_t selected[6];
+        std::copy(key, key + 6, selected);
+        trie.predecessor(selected, 6);
+        if (amt::get6Int(selected) != k) {
+            throw std::runtime_error(name + " lost a key");
+        }
+    }
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    std::cerr << name << (hugePages ? " (huge pages)" : "") << ": " << keys.size() / seconds / 1e6 << "[M inserts/s], "
+              << trie.memSize() << " arena bytes, " << usage.ru_maxrss * 1024 << " peak RSS bytes" << std::endl;
+}
+
+/**
+ * Returns a stream of the given keys for bulk loading a Set.
+ */
+static amt::Set::NextKey keyStream(const std::vector<uint32_t>& keys)
+{
+    return [&keys, i = (uint64_t) 0](uint8_t* key) mutable {
+        if (i == keys.size()) return false;
+        amt::set6Int(key, keys[i++]);
+        return true;
+    };
+}
+
+/**
+ * Times bulk loading sorted keys, some of them repeated, into a Set and checks that it has each key
+ * once and answers predecessor queries the same as a Set the keys were inserted into one at a time.
+ * Also checks that keys out of order are rejected.
+ */
+static void timeBulkLoad(xoroshiro::xoroshiro128plus_engine& eng, const std::vector<uint32_t>& sorted, const std::vector<uint32_t>& repeated, bool hugePages)
+{
+    auto startTime = std::chrono::steady_clock::now();
+    amt::Set bulk(keyStream(repeated), 6, hugePages);
+    auto endTime = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration_cast<std::chrono::nanoseconds>(endTime - startTime).count() / 1e9;
+
+    amt::Set inserted(1024, hugePages);
+    uint8_t key[6], expected[6];
+    for (uint32_t k : sorted) {
+        amt::set6Int(key, k);
+        inserted.set(key, 6);
+    }
+    if (bulk.size() != sorted.size() || inserted.size() != sorted.size()) {
+        throw std::runtime_error("set bulk load has the wrong number of keys");
+    }
+    for (uint64_t j = 0; j < sorted.size(); j++) {
+        amt::set6Int(key, (uint32_t) eng());
+        std::copy(key, key + 6, expected);
+        bulk.predecessor(key, 6);
+        inserted.predecessor(expected, 6);
+        if (!std::equal(key, key + 6, expected)) {
+            throw std::runtime_error("set bulk load has a different predecessor");
+        }
+    }
+
+    // the last digit going backwards after a key in the same leaf
+    std::vector<uint32_t> unordered = {5, 7, 7, 6};
+    bool rejected = false;
+    try {
+        amt::Set set(keyStream(unordered), 6);
+    } catch (const std::runtime_error&) {
+        rejected = true;
+    }
+    if (!rejected) {
+        throw std::runtime_error("set bulk load accepted keys out of order");
+    }
+
+    std::cerr << "set bulk load" << (hugePages ? " (huge pages)" : "") << ": " << repeated.size() / seconds / 1e6 << "[M inserts/s], "
+              << bulk.memSize() << " arena bytes" << std::endl;
+}
+
+void amtInsert(xoroshiro::xoroshiro128plus_engine& eng, uint32_t numKeys)
+{
+    // distinct random 32 bit keys in random and sorted order
+    std::vector<uint32_t> keys(numKeys);
+    for (uint32_t& k : keys) {
+        k = (uint32_t) eng();
+    }
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+    std::vector<uint32_t> sorted = keys;
+    // about a quarter of the keys repeated, to check that bulk loading ignores them
+    std::vector<uint32_t> repeated;
+    for (uint32_t k : sorted) {
+        repeated.push_back(k);
+        if (eng() % 4 == 0) {
+            repeated.push_back(k);
+        }
+    }
+    for (uint64_t i = keys.size(); i > 1; i--) {
+        std::swap(keys[i - 1], keys[eng() % i]);
+    }
+    std::cerr << "keys: " << keys.size() << std::endl;
+
+    auto setInsert = [](amt::Set& set, uint8_t* key, uint32_t) { set.set(key, 6); };
+    auto mapInsert = [](amt::Map& map, uint8_t* key, uint32_t k) { map.set(key, 6, k); };
+    for (bool hugePages : {false, true}) {
+        timeInserts<amt::Set>("set random order", keys, hugePages, setInsert);
+        timeInserts<amt::Set>("set sorted order", sorted, hugePages, setInsert);
+        timeBulkLoad(eng, sorted, repeated, hugePages);
+        timeInserts<amt::Map>("map random order", keys, hugePages, mapInsert);
+        timeInserts<amt::Map>("map sorted order", sorted, hugePages, mapInsert);
+    }
+}
+
+}
@@ -0,0 +1,209 @@
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <sdsl/bit_vectors.hpp>
+#include <sdsl/util.hpp>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "amt/bitops.hpp"
+#include "amt/compressed_sum_set.hpp"
+#include "amt/key.hpp"
+#include "amt/level_order_sum_set.hpp"
+#include "bench/bench.hpp"
+
+namespace bench {
+
+/**
+ * Returns a stream of the given sorted keys for building a set.
+ */
+template <class Key>
+static std::function<amt::Set::NextKey()> keyStream(const std::vector<uint64_t>& keys)
+{
+    return [&keys]() {
+        return amt::Set::NextKey([&keys, i = (uint64_t) 0](uint8_t* key) mutable {
+            if (i == keys.size()) return false;
+            Key::set(key, keys[i++]);
+            return true;
+        });
+    };
+}
+
+/**
+ * Checks a set's predecessor queries against binary searches and returns their average time in
+ * nanoseconds. The ranks are added to the checksum so the queries can't be optimized away.
+ */
+template <class Key, class Set>
+static double timePredecessors(std::string name, Set& set, const std::vector<uint64_t>& keys, const std::vector<uint64_t>& queries, uint64_t& checksum)
+{
+    uint8_t key[Key::LENGTH];
+    for (uint64_t q : queries) {
+        Key::set(key, q);
+        uint64_t rank = set.predecessor(key);
+        auto it = std::lower_bound(keys.begin(), keys.end(), q);
+        uint64_t expected = (it != keys.end() && *it == q) ? q : *(it - 1);
+        if (rank != (uint64_t) (it - keys.begin()) || Key::get(key) != expected) {
+            throw std::runtime_error(name + " selected the wrong key");
+        }
+    }
+
+    auto startTime = std::chrono::steady_clock::now();
+    for (uint64_t q : queries) {
+        Key::set(key, q);
+        checksum += set.predecessor(key);
+    }
+    auto endTime = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(endTime - startTime).count() / (double) queries.size();
+}
+
+/**
+ * Checks that a CompressedSumSet ignores repeated keys, including repeats in the same leaf, and
+ * rejects keys out of order.
+ */
+template <class Key>
+static void checkKeyOrder(bool leafCounts)
+{
+    const uint64_t far = ((uint64_t) 1) << 20;
+    std::vector<std::vector<uint64_t>> repeated = {{5, 6, 6, far}, {5, 6, 6, 7, 7, far}};
+    uint8_t key[Key::LENGTH];
+    for (const std::vector<uint64_t>& keys : repeated) {
+        amt::CompressedSumSet<Key> set(keyStream<Key>(keys), leafCounts);
+        std::vector<uint64_t> distinct(keys);
+        distinct.erase(std::unique(distinct.begin(), distinct.end()), distinct.end());
+        Key::set(key, far);
+        if (set.size() != distinct.size() || set.predecessor(key) != distinct.size() - 1) {
+            throw std::runtime_error("compressed set counted a repeated key");
+        }
+    }
+
+    std::vector<uint64_t> unordered = {5, 7, 7, 6};
+    bool rejected = false;
+    try {
+        amt::CompressedSumSet<Key> set(keyStream<Key>(unordered), leafCounts);
+    } catch (const std::runtime_error&) {
+        rejected = true;
+    }
+    if (!rejected) {
+        throw std::runtime_error("compressed set accepted keys out of order");
+    }
+}
+
+/**
+ * Times predecessor queries on a CompressedSumSet of the given keys, with or without leaf counts,
+ * one at a time and as one batch, and prints the average query times and the memory used.
+ */
+template <class Key>
+static void timeCompressed(std::string name, const std::vector<uint64_t>& keys, const std::vector<uint64_t>& queries, bool leafCounts)
+{
+    name += leafCounts ? ", leaf counts" : ", leaf popcounts";
+    amt::CompressedSumSet<Key> set(keyStream<Key>(keys), leafCounts);
+    uint64_t checksum = 0;
+    double nanoseconds = timePredecessors<Key>(name, set, keys, queries, checksum);
+
+    std::vector<uint64_t> values(queries), ranks(queries.size());
+    auto startTime = std::chrono::steady_clock::now();
+    set.predecessors(values.data(), ranks.data(), values.size());
+    auto endTime = std::chrono::steady_clock::now();
+    double batchNanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(endTime - startTime).count();
+    for (uint64_t j = 0; j < queries.size(); j++) {
+        auto it = std::upper_bound(keys.begin(), keys.end(), queries[j]);
+        if (ranks[j] != (uint64_t) (std::lower_bound(keys.begin(), keys.end(), queries[j]) - keys.begin()) || values[j] != *(it - 1)) {
+            throw std::runtime_error(name + " selected the wrong key in a batch");
+        }
+        checksum += ranks[j];
+    }
+
+    std::cerr << name << ": " << nanoseconds << "[ns/query], batched " << batchNanoseconds / queries.size()
+              << "[ns/query], " << set.memSize() << " bytes, "
+              << 8.0 * set.memSize() / keys.size() << " bits/key (checksum " << checksum << ")" << std::endl;
+}
+
+/**
+ * Times predecessor queries on a LevelOrderSumSet of the given keys and prints the average query
+ * time and the memory used.
+ */
+template <class Key, int block_words>
+static void timeLevelOrder(std::string name, const std::vector<uint64_t>& keys, const std::vector<uint64_t>& queries)
+{
+    name += ", level order, " + std::to_string(block_words) + " word blocks";
+    amt::LevelOrderSumSet<Key, block_words> set(keyStream<Key>(keys));
+    uint64_t checksum = 0;
+    double nanoseconds = timePredecessors<Key>(name, set, keys, queries, checksum);
+    std::cerr << name << ": " << nanoseconds << "[ns/query], " << set.memSize() << " bytes, "
+              << 8.0 * set.memSize() / keys.size() << " bits/key (checksum " << checksum << ")" << std::endl;
+}
+
+/**
+ * Times rank and select queries on an sd_vector of the given keys and prints the average query
+ * time and the memory used.
+ */
+static void timeSD(std::string name, const std::vector<uint64_t>& keys, const std::vector<uint64_t>& queries)
+{
+    sdsl::sd_vector<> bitvector(keys.begin(), keys.end());
+    sdsl::sd_vector<>::rank_1_type bitvectorRank(&bitvector);
+    sdsl::sd_vector<>::select_1_type bitvectorSelect(&bitvector);
+    uint64_t rank, select;
+    for (uint64_t q : queries) {
+        // q+1 because rank is exclusive [0, q) and we want inclusive [0, q]
+        rank = bitvectorRank.rank(q + 1);
+        auto it = std::upper_bound(keys.begin(), keys.end(), q);
+        if (rank != (uint64_t) (it - keys.begin()) || bitvectorSelect.select(rank) != *(it - 1)) {
+            throw std::runtime_error(name + " sd_vector selected the wrong key");
+        }
+    }
+
+    uint64_t checksum = 0;
+    auto startTime = std::chrono::steady_clock::now();
+    for (uint64_t q : queries) {
+        rank = bitvectorRank.rank(q + 1);
+        select = bitvectorSelect.select(rank);
+        checksum += rank + select;
+    }
+    auto endTime = std::chrono::steady_clock::now();
+    double nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(endTime - startTime).count();
+
+    uint64_t memSize = sdsl::size_in_bytes(bitvector) + sdsl::size_in_bytes(bitvectorRank) + sdsl::size_in_bytes(bitvectorSelect);
+    std::cerr << name << ", sd_vector: " << nanoseconds / queries.size() << "[ns/query], " << memSize << " bytes, "
+              << 8.0 * memSize / keys.size() << " bits/key (checksum " << checksum << ")" << std::endl;
+}
+
+void amtPredecessor(xoroshiro::xoroshiro128plus_engine& eng, uint32_t numKeys)
+{
+    // keys spread over 32 bits, and keys with small gaps like the phrase starts of a grammar
+    std::vector<uint64_t> sparse(numKeys), dense(numKeys);
+    for (uint64_t& k : sparse) {
+        k = (uint32_t) eng();
+    }
+    std::sort(sparse.begin(), sparse.end());
+    sparse.erase(std::unique(sparse.begin(), sparse.end()), sparse.end());
+    uint64_t position = 0;
+    for (uint64_t& k : dense) {
+        k = position;
+        position += 1 + eng() % 16;
+    }
+
+    for (bool leafCounts : {false, true}) {
+        checkKeyOrder<amt::Key6>(leafCounts);
+        checkKeyOrder<amt::Key11>(leafCounts);
+    }
+
+    std::cerr << "popcount kernel: " << amt::popcountSumKernel() << std::endl;
+    for (std::vector<uint64_t>* keys : {&sparse, &dense}) {
+        std::vector<uint64_t> queries(numKeys);
+        for (uint64_t& q : queries) {
+            q = keys->front() + eng() % (keys->back() - keys->front() + 1);
+        }
+        std::string name = (keys == &sparse) ? "sparse" : "dense";
+        for (bool leafCounts : {false, true}) {
+            timeCompressed<amt::Key6>(name + " 6 digit keys", *keys, queries, leafCounts);
+            timeCompressed<amt::Key11>(name + " 11 digit keys", *keys, queries, leafCounts);
+        }
+        timeLevelOrder<amt::Key6, 8>(name + " 6 digit keys", *keys, queries);
+        timeLevelOrder<amt::Key6, 32>(name + " 6 digit keys", *keys, queries);
+        timeLevelOrder<amt::Key11, 8>(name + " 11 digit keys", *keys, queries);
+        timeLevelOrder<amt::Key11, 32>(name + " 11 digit keys", *keys, queries);
+        timeSD(name, *keys, queries);
+    }
+}
+
+}
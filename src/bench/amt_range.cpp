@@ -0,0 +1,121 @@
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <ranges>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "amt/key.hpp"
+#include "amt/map.hpp"
+#include "amt/range.hpp"
+#include "amt/set.hpp"
+#include "bench/bench.hpp"
+
+namespace bench {
+
+typedef std::pair<uint32_t, uint32_t> KeyBounds;
+
+/** Counts the keys it visits and sums their values. */
+class SumVisitor : public amt::MapVisitor
+{
+public:
+    uint64_t count = 0;
+    uint64_t sum = 0;
+
+    void visit(uint8_t*, int, uint64_t value)
+    {
+        count++;
+        sum += value;
+    }
+};
+
+/**
+ * Times a range scan method over all the ranges and prints the average time per range and per key
+ * scanned. The scan returns the number of keys it scanned and adds their values to the sum.
+ */
+template <class Scan>
+static void timeScans(std::string name, const std::vector<KeyBounds>& ranges, uint64_t& count, uint64_t& sum, Scan scan)
+{
+    count = 0;
+    sum = 0;
+    auto startTime = std::chrono::steady_clock::now();
+    for (const KeyBounds& range : ranges) {
+        count += scan(range.first, range.second, sum);
+    }
+    auto endTime = std::chrono::steady_clock::now();
+    double nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(endTime - startTime).count();
+    std::cerr << name << ": " << nanoseconds / ranges.size() << "[ns/range], " << nanoseconds / std::max(count, (uint64_t) 1)
+              << "[ns/key] (" << count << " keys, checksum " << sum << ")" << std::endl;
+}
+
+void amtRange(xoroshiro::xoroshiro128plus_engine& eng, uint32_t numKeys)
+{
+    // random 32 bit keys whose values are their insertion order
+    amt::Map map(1024);
+    std::vector<uint32_t> keys(numKeys);
+    uint8_t key[6];
+    for (uint32_t i = 0; i < numKeys; i++) {
+        keys[i] = (uint32_t) eng();
+        amt::set6Int(key, keys[i]);
+        map.set(key, 6, i);
+    }
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+    uint64_t i = 0;
+    amt::Set set([&](uint8_t* key) {
+        if (i == keys.size()) return false;
+        amt::set6Int(key, keys[i++]);
+        return true;
+    }, 6);
+    std::cerr << "keys: " << keys.size() << std::endl;
+
+    // ranges of about 1000 keys
+    uint64_t width = std::max((uint64_t) 1, (((uint64_t) 1) << 32) / keys.size() * 1000);
+    std::vector<KeyBounds> ranges(1000);
+    for (KeyBounds& range : ranges) {
+        uint32_t begin = (uint32_t) eng();
+        range = {begin, (uint32_t) std::min((uint64_t) UINT32_MAX, begin + width - 1)};
+    }
+
+    uint64_t visitorCount, visitorSum, count, sum;
+    timeScans("map visitor", ranges, visitorCount, visitorSum, [&map](uint32_t begin, uint32_t end, uint64_t& sum) {
+        SumVisitor visitor;
+        map.visitRange(visitor, begin, end, 6);
+        sum += visitor.sum;
+        return visitor.count;
+    });
+    timeScans("map range", ranges, count, sum, [&map](uint32_t begin, uint32_t end, uint64_t& sum) {
+        uint64_t count = 0;
+        for (amt::RangeEntry entry : amt::KeyRange<amt::Map>(map, begin, end, 6)) {
+            count++;
+            sum += entry.value;
+        }
+        return count;
+    });
+    if (count != visitorCount || sum != visitorSum) {
+        throw std::runtime_error("map range and visitor scanned different keys");
+    }
+    timeScans("set range", ranges, count, sum, [&set](uint32_t begin, uint32_t end, uint64_t& sum) {
+        uint64_t count = 0;
+        for (amt::RangeEntry entry : amt::KeyRange<amt::Set>(set, begin, end, 6)) {
+            count++;
+            sum += entry.key;
+        }
+        return count;
+    });
+    if (count != visitorCount) {
+        throw std::runtime_error("set range and map visitor scanned different keys");
+    }
+
+    // a visitor can't stop early, so it scans the whole range to get its first keys
+    timeScans("map range, first 10 keys", ranges, count, sum, [&map](uint32_t begin, uint32_t end, uint64_t& sum) {
+        uint64_t count = 0;
+        for (amt::RangeEntry entry : amt::KeyRange<amt::Map>(map, begin, end, 6) | std::views::take(10)) {
+            count++;
+            sum += entry.value;
+        }
+        return count;
+    });
+}
+
+}
@@ -0,0 +1,192 @@
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>  // strncpy
+#include <deque>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+#include "bench/bench.hpp"
+#include "cfg/query_server.hpp"
+
+namespace bench {
+
+typedef std::chrono::steady_clock::time_point TimePoint;
+
+static int connect(std::string socketPath)
+{
+    struct sockaddr_un address;
+    if (socketPath.size() >= sizeof(address.sun_path)) {
+        throw std::runtime_error("socket path is too long");
+    }
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, socketPath.c_str(), sizeof(address.sun_path) - 1);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd == -1 || ::connect(fd, (struct sockaddr*) &address, sizeof(address)) == -1) {
+        if (fd != -1) close(fd);
+        throw std::runtime_error("failed to connect to " + socketPath);
+    }
+    return fd;
+}
+
+static void sendAll(int fd, const char* data, uint64_t length)
+{
+    ssize_t n;
+    while (length > 0) {
+        n = send(fd, data, length, MSG_NOSIGNAL);
+        if (n == -1) {
+            if (errno == EINTR) continue;
+            throw std::runtime_error("failed to send requests");
+        }
+        data += n;
+        length -= n;
+    }
+}
+
+static uint64_t receiveUint64(int fd)
+{
+    char buffer[sizeof(uint64_t)];
+    uint64_t received = 0;
+    ssize_t n;
+    while (received < sizeof(uint64_t)) {
+        n = recv(fd, buffer + received, sizeof(uint64_t) - received, 0);
+        if (n <= 0) {
+            if (n == -1 && errno == EINTR) continue;
+            throw std::runtime_error("failed to receive response");
+        }
+        received += n;
+    }
+    return cfg::QueryServer::getUint64(buffer);
+}
+
+/**
+ * Runs one connection's share of the queries, keeping depth requests in flight, and records the
+ * latency of each one.
+ */
+static void runConnection(int fd, uint64_t textLength, uint32_t querySize, uint64_t numQueries, uint32_t depth, uint64_t seed, std::vector<double>& latencies)
+{
+    std::mt19937_64 eng(seed);
+    std::uniform_int_distribution<uint64_t> dist(0, textLength - querySize);
+    std::vector<char> requests(depth * cfg::QueryServer::REQUEST_SIZE);
+    std::vector<char> buffer(1 << 16);
+    std::deque<TimePoint> sendTimes;
+
+    uint64_t sent = 0, received = 0;
+    // the bytes of the current response header and the characters left to skip
+    char header[sizeof(uint64_t)];
+    uint64_t headerSize = 0, remaining = 0;
+    ssize_t n;
+    while (received < numQueries) {
+        // top up the requests in flight with one send
+        uint64_t count = std::min((uint64_t) depth - sendTimes.size(), numQueries - sent);
+        if (count > 0) {
+            uint64_t begin;
+            for (uint64_t i = 0; i < count; i++) {
+                begin = dist(eng);
+                cfg::QueryServer::putUint64(requests.data() + i * cfg::QueryServer::REQUEST_SIZE, begin);
+                cfg::QueryServer::putUint64(requests.data() + i * cfg::QueryServer::REQUEST_SIZE + sizeof(uint64_t), begin + querySize);
+            }
+            TimePoint now = std::chrono::steady_clock::now();
+            sendAll(fd, requests.data(), count * cfg::QueryServer::REQUEST_SIZE);
+            sendTimes.insert(sendTimes.end(), count, now);
+            sent += count;
+        }
+
+        n = recv(fd, buffer.data(), buffer.size(), 0);
+        if (n <= 0) {
+            if (n == -1 && errno == EINTR) continue;
+            throw std::runtime_error("failed to receive response");
+        }
+        TimePoint now = std::chrono::steady_clock::now();
+        for (char* p = buffer.data(), *end = buffer.data() + n; p < end;) {
+            if (remaining > 0) {
+                uint64_t skip = std::min(remaining, (uint64_t) (end - p));
+                p += skip;
+                remaining -= skip;
+            } else {
+                header[headerSize++] = *p++;
+                if (headerSize < sizeof(uint64_t)) continue;
+                headerSize = 0;
+                remaining = cfg::QueryServer::getUint64(header);
+                if (remaining != querySize) {
+                    throw std::runtime_error("server returned an error or a substring of the wrong length");
+                }
+            }
+            if (remaining == 0 && headerSize == 0) {
+                latencies.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(now - sendTimes.front()).count() / 1e3);
+                sendTimes.pop_front();
+                received++;
+            }
+        }
+    }
+}
+
+void client(std::string socketPath, xoroshiro::xoroshiro128plus_engine& eng, uint32_t querySize, uint32_t numQueries, uint32_t numConnections, uint32_t depth)
+{
+    // ask for the text length so the queries are in bounds
+    int fd = connect(socketPath);
+    char request[cfg::QueryServer::REQUEST_SIZE];
+    cfg::QueryServer::putUint64(request, cfg::QueryServer::INFO);
+    cfg::QueryServer::putUint64(request + sizeof(uint64_t), cfg::QueryServer::INFO);
+    sendAll(fd, request, cfg::QueryServer::REQUEST_SIZE);
+    uint64_t textLength = receiveUint64(fd);
+    close(fd);
+    if (querySize == 0 || querySize > textLength) {
+        throw std::runtime_error("querysize must be between 1 and the text length");
+    }
+    if (numQueries == 0 || numConnections == 0 || depth == 0) {
+        throw std::runtime_error("numqueries, connections and depth must be positive");
+    }
+    std::cerr << "text length: " << textLength << std::endl;
+
+    std::vector<int> fds;
+    for (uint32_t i = 0; i < numConnections; i++) {
+        fds.push_back(connect(socketPath));
+    }
+    std::vector<std::vector<double>> latencies(numConnections);
+    std::vector<std::exception_ptr> errors(numConnections);
+
+    auto startTime = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    for (uint32_t i = 0; i < numConnections; i++) {
+        uint64_t share = numQueries / numConnections + (i < numQueries % numConnections);
+        uint64_t seed = eng();
+        threads.emplace_back([&, i, share, seed]() {
+            try {
+                runConnection(fds[i], textLength, querySize, share, depth, seed, latencies[i]);
+            } catch (...) {
+                errors[i] = std::current_exception();
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    auto endTime = std::chrono::steady_clock::now();
+    for (int fd : fds) {
+        close(fd);
+    }
+    for (std::exception_ptr& error : errors) {
+        if (error) std::rethrow_exception(error);
+    }
+
+    std::vector<double> all;
+    for (std::vector<double>& l : latencies) {
+        all.insert(all.end(), l.begin(), l.end());
+    }
+    std::sort(all.begin(), all.end());
+    double seconds = std::chrono::duration_cast<std::chrono::nanoseconds>(endTime - startTime).count() / 1e9;
+    auto percentile = [&all](double p) { return all[std::min((uint64_t) (p * all.size()), (uint64_t) all.size() - 1)]; };
+    std::cerr << "connections: " << numConnections << ", depth: " << depth << std::endl;
+    std::cerr << "throughput: " << numQueries / seconds << "[queries/s], " << (double) numQueries * querySize / seconds / 1e6 << "[MB/s]" << std::endl;
+    std::cerr << "latency p50: " << percentile(0.5) << "[µs], p99: " << percentile(0.99) << "[µs], p99.9: " << percentile(0.999) << "[µs], max: " << all.back() << "[µs]" << std::endl;
+}
+
+}
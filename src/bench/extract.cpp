@@ -0,0 +1,60 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>  // memcmp
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include "bench/bench.hpp"
+#include "cfg/parallel_extractor.hpp"
+#include "cfg/random_access_v2_sd.hpp"
+
+namespace bench {
+
+/**
+ * Times decompressing the whole text and returns the median time in seconds.
+ */
+template <class Extract>
+double timeExtraction(Extract extract)
+{
+    // fewer loops than the other benchmarks since each one decompresses the whole text
+    uint32_t numLoops = 5;
+    std::vector<double> times(numLoops);
+    for (int i = 0; i < numLoops; i++) {
+        auto startTime = std::chrono::steady_clock::now();
+        extract();
+        auto endTime = std::chrono::steady_clock::now();
+        times[i] = std::chrono::duration_cast<std::chrono::nanoseconds>(endTime - startTime).count() / 1e9;
+    }
+    std::sort(times.begin(), times.end());
+    return times[numLoops / 2];
+}
+
+void extract(cfg::CFG* cfg)
+{
+    uint64_t length = cfg->textLength;
+    char* expected = new char[length];
+    char* out = new char[length];
+
+    cfg::RandomAccessV2SD<> sd(cfg);
+    double time = timeExtraction([&]() { sd.get(expected, 0, length); });
+    std::cerr << "sequential SD get: " << time << "[s], " << length / time / 1e9 << "[GB/s]" << std::endl;
+
+    int maxThreads = std::max(1u, std::thread::hardware_concurrency());
+    for (int numThreads = 1; ; numThreads = std::min(2 * numThreads, maxThreads)) {
+        cfg::ParallelExtractor extractor(cfg, numThreads);
+        std::fill(out, out + length, 0);
+        extractor.extract(out, 0, length);
+        if (std::memcmp(out, expected, length) != 0) {
+            throw std::runtime_error("parallel extraction disagrees with random access");
+        }
+        time = timeExtraction([&]() { extractor.extract(out, 0, length); });
+        std::cerr << "parallel extraction with " << numThreads << " threads: " << time << "[s], " << length / time / 1e9 << "[GB/s]" << std::endl;
+        if (numThreads == maxThreads) break;
+    }
+
+    delete[] expected;
+    delete[] out;
+}
+
+}
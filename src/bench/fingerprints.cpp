@@ -0,0 +1,103 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>  // memcmp
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "bench/bench.hpp"
+#include "cfg/random_access_v2_kr.hpp"
+
+namespace bench {
+
+/**
+ * Times a query method over all of the query pairs and returns the median of the average query
+ * times in nanoseconds.
+ */
+template <class Query>
+double timeQueries(std::vector<std::pair<uint64_t, uint64_t>>& queries, uint64_t& checksum, Query query)
+{
+    uint32_t numLoops = 11;
+    std::vector<double> times(numLoops);
+    for (int i = 0; i < numLoops; i++) {
+        auto startTime = std::chrono::steady_clock::now();
+        for (auto& [a, b] : queries) {
+            checksum += query(a, b);
+        }
+        auto endTime = std::chrono::steady_clock::now();
+        double duration = std::chrono::duration_cast<std::chrono::nanoseconds>(endTime - startTime).count();
+        times[i] = duration / queries.size();
+    }
+    std::sort(times.begin(), times.end());
+    return times[numLoops / 2];
+}
+
+void fingerprints(cfg::CFG* cfg, xoroshiro::xoroshiro128plus_engine& eng, uint32_t querySize, uint32_t numQueries)
+{
+    cfg::RandomAccessV2KR<> kr(cfg, eng());
+    std::cerr << "krv2 mem size: " << kr.memSize() << std::endl;
+
+    // decompress the text to check the answers against
+    std::string text(cfg->textLength, 0);
+    kr.get(text.data(), 0, cfg->textLength);
+
+    // pair half of the positions with an earlier occurrence of their next 8 characters so that
+    // some comparisons are equal and some extensions are long
+    const uint64_t gramSize = 8;
+    std::unordered_map<std::string, uint64_t> firstOccurrences;
+    for (uint64_t i = 0; i + gramSize <= text.size(); i++) {
+        firstOccurrences.try_emplace(text.substr(i, gramSize), i);
+    }
+    std::uniform_int_distribution<uint64_t> dist(0, cfg->textLength - querySize);
+    std::vector<std::pair<uint64_t, uint64_t>> queries(numQueries);
+    uint64_t i, j;
+    for (uint32_t q = 0; q < numQueries; q++) {
+        i = dist(eng);
+        j = dist(eng);
+        if (q % 2 == 0 && i + gramSize <= text.size()) {
+            j = firstOccurrences[text.substr(i, gramSize)];
+        }
+        queries[q] = {i, j};
+    }
+
+    // make sure the answers are correct before timing them
+    uint64_t numEqual = 0, lceSum = 0, length;
+    for (auto& [a, b] : queries) {
+        bool equal = std::memcmp(text.data() + a, text.data() + b, querySize) == 0;
+        if (kr.equal(a, b, querySize) != equal) {
+            throw std::runtime_error("fingerprint equality disagrees with the text");
+        }
+        for (length = 0; std::max(a, b) + length < text.size() && text[a + length] == text[b + length]; length++);
+        if (kr.lce(a, b) != length) {
+            throw std::runtime_error("longest common extension disagrees with the text");
+        }
+        numEqual += equal;
+        lceSum += length;
+    }
+
+    uint64_t checksum = 0;
+    char* out1 = new char[querySize];
+    char* out2 = new char[querySize];
+    double extractTime = timeQueries(queries, checksum, [&](uint64_t a, uint64_t b) {
+        kr.get(out1, a, a + querySize);
+        kr.get(out2, b, b + querySize);
+        return std::memcmp(out1, out2, querySize) == 0;
+    });
+    delete[] out1;
+    delete[] out2;
+    double equalTime = timeQueries(queries, checksum,
+        [&kr, querySize](uint64_t a, uint64_t b) { return kr.equal(a, b, querySize); });
+    double lceTime = timeQueries(queries, checksum,
+        [&kr](uint64_t a, uint64_t b) { return kr.lce(a, b); });
+
+    std::cerr << "equal pairs: " << numEqual << " of " << numQueries << std::endl;
+    std::cerr << "average lce: " << (double) lceSum / numQueries << std::endl;
+    std::cerr << "average extract+compare time: " << extractTime << "[ns]" << std::endl;
+    std::cerr << "average fingerprint equal time: " << equalTime << "[ns]" << std::endl;
+    std::cerr << "average fingerprint lce time: " << lceTime << "[ns]" << std::endl;
+    std::cerr << "checksum: " << checksum << std::endl;
+}
+
+}
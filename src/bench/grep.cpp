@@ -0,0 +1,87 @@
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "bench/bench.hpp"
+#include "cfg/dfa.hpp"
+#include "cfg/dfa_scanner.hpp"
+#include "cfg/random_access_v2_sd.hpp"
+
+namespace bench {
+
+void grep(cfg::CFG* cfg, xoroshiro::xoroshiro128plus_engine& eng, uint32_t patternSize, uint32_t numQueries)
+{
+    // decompress the text for the baseline and to sample patterns from
+    std::string text(cfg->textLength, 0);
+    {
+        cfg::RandomAccessV2SD<> sd(cfg);
+        sd.get(text.data(), 0, cfg->textLength);
+    }
+
+    std::uniform_int_distribution<uint64_t> dist(0, cfg->textLength - patternSize);
+    double coldTime = 0, warmTime = 0, fillTime = 0, firstTime = 0, textTime = 0;
+    uint64_t memoized = 0, numMatches = 0, memSize = 0;
+    for (uint32_t i = 0; i < numQueries; i++) {
+        cfg::DFA dfa = cfg::DFA::fromPattern(text.substr(dist(eng), patternSize));
+
+        // run the DFA over the text
+        auto startTime = std::chrono::steady_clock::now();
+        std::vector<uint64_t> expected;
+        int state = dfa.getStartState();
+        for (uint64_t p = 0; p < text.size(); p++) {
+            state = dfa.next(state, (unsigned char) text[p]);
+            if (dfa.isAccepting(state)) expected.push_back(p);
+        }
+        auto endTime = std::chrono::steady_clock::now();
+        textTime += std::chrono::duration_cast<std::chrono::microseconds>(endTime - startTime).count();
+
+        // run the DFA over the grammar with an empty memo and then with the memo it filled
+        std::vector<uint64_t> matches;
+        cfg::DFAScanner scanner(cfg, dfa);
+        startTime = std::chrono::steady_clock::now();
+        scanner.forEachMatch([&matches](uint64_t p) { matches.push_back(p); return true; });
+        endTime = std::chrono::steady_clock::now();
+        coldTime += std::chrono::duration_cast<std::chrono::microseconds>(endTime - startTime).count();
+        memoized += scanner.getNumMemoized();
+
+        startTime = std::chrono::steady_clock::now();
+        uint64_t count = scanner.count();
+        endTime = std::chrono::steady_clock::now();
+        warmTime += std::chrono::duration_cast<std::chrono::microseconds>(endTime - startTime).count();
+
+        if (matches != expected || count != expected.size()) {
+            throw std::runtime_error("grammar matches disagree with the text");
+        }
+        numMatches += count;
+
+        // the first match with a memo filled bottom-up
+        cfg::DFAScanner filled(cfg, dfa);
+        startTime = std::chrono::steady_clock::now();
+        filled.fill();
+        endTime = std::chrono::steady_clock::now();
+        fillTime += std::chrono::duration_cast<std::chrono::microseconds>(endTime - startTime).count();
+
+        uint64_t first;
+        startTime = std::chrono::steady_clock::now();
+        bool found = filled.firstMatch(first);
+        endTime = std::chrono::steady_clock::now();
+        firstTime += std::chrono::duration_cast<std::chrono::microseconds>(endTime - startTime).count();
+        if (found != !expected.empty() || (found && first != expected[0])) {
+            throw std::runtime_error("grammar first match disagrees with the text");
+        }
+        memSize = std::max(memSize, filled.memSize());
+    }
+
+    std::cerr << "max scanner mem size: " << memSize << std::endl;
+    std::cerr << "average matches: " << (double) numMatches / numQueries << std::endl;
+    std::cerr << "average memoized transitions: " << (double) memoized / numQueries << std::endl;
+    std::cerr << "average text scan time: " << textTime / numQueries << "[µs]" << std::endl;
+    std::cerr << "average cold grammar scan time: " << coldTime / numQueries << "[µs]" << std::endl;
+    std::cerr << "average warm grammar scan time: " << warmTime / numQueries << "[µs]" << std::endl;
+    std::cerr << "average bottom-up fill time: " << fillTime / numQueries << "[µs]" << std::endl;
+    std::cerr << "average first match time: " << firstTime / numQueries << "[µs]" << std::endl;
+}
+
+}
@@ -0,0 +1,99 @@
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "bench/bench.hpp"
+#include "cfg/random_access_v2_lines.hpp"
+
+namespace bench {
+
+/**
+ * Times a query method over all of the queries and returns the median of the average query times
+ * in nanoseconds.
+ */
+template <class Query>
+double timeLineQueries(std::vector<uint64_t>& queries, uint64_t& checksum, Query query)
+{
+    uint32_t numLoops = 11;
+    std::vector<double> times(numLoops);
+    for (int i = 0; i < numLoops; i++) {
+        auto startTime = std::chrono::steady_clock::now();
+        for (uint64_t q : queries) {
+            checksum += query(q);
+        }
+        auto endTime = std::chrono::steady_clock::now();
+        double duration = std::chrono::duration_cast<std::chrono::nanoseconds>(endTime - startTime).count();
+        times[i] = duration / queries.size();
+    }
+    std::sort(times.begin(), times.end());
+    return times[numLoops / 2];
+}
+
+void lines(cfg::CFG* cfg, xoroshiro::xoroshiro128plus_engine& eng, uint32_t numQueries)
+{
+    cfg::RandomAccessV2Lines<> lines(cfg);
+    std::cerr << "lines mem size: " << lines.linesMemSize() << std::endl;
+    std::cerr << "linesv2 mem size: " << lines.memSize() << std::endl;
+    std::cerr << "num newlines: " << lines.numNewlines() << std::endl;
+
+    // compute where each line begins in the decompressed text
+    std::string text(cfg->textLength, 0);
+    lines.get(text.data(), 0, cfg->textLength);
+    std::vector<uint64_t> lineStarts = {0};
+    for (uint64_t i = 0; i < text.size(); i++) {
+        if (text[i] == '\n') lineStarts.push_back(i + 1);
+    }
+
+    std::uniform_int_distribution<uint64_t> lineDist(0, lines.numNewlines());
+    std::uniform_int_distribution<uint64_t> positionDist(0, cfg->textLength - 1);
+    std::vector<uint64_t> lineQueries(numQueries), positionQueries(numQueries);
+    for (uint32_t i = 0; i < numQueries; i++) {
+        lineQueries[i] = lineDist(eng);
+        positionQueries[i] = positionDist(eng);
+    }
+
+    // make sure the answers are correct before timing them
+    std::string line;
+    uint64_t lineLength = 0;
+    for (uint32_t i = 0; i < numQueries; i++) {
+        uint64_t k = lineQueries[i];
+        uint64_t end = (k + 1 < lineStarts.size()) ? lineStarts[k + 1] - 1 : text.size();
+        lines.getLine(k, line);
+        if (lines.selectLine(k) != lineStarts[k] || line != text.substr(lineStarts[k], end - lineStarts[k])) {
+            throw std::runtime_error("line disagrees with the text");
+        }
+        lineLength += line.size();
+        uint64_t p = positionQueries[i];
+        uint64_t expected = std::upper_bound(lineStarts.begin(), lineStarts.end(), p) - lineStarts.begin() - 1;
+        if (lines.lineOf(p) != expected) {
+            throw std::runtime_error("line of position disagrees with the text");
+        }
+    }
+
+    uint64_t checksum = 0;
+    char* out = new char[cfg->textLength];
+    double selectTime = timeLineQueries(lineQueries, checksum,
+        [&lines](uint64_t k) { return lines.selectLine(k); });
+    double lineOfTime = timeLineQueries(positionQueries, checksum,
+        [&lines](uint64_t p) { return lines.lineOf(p); });
+    double extractTime = timeLineQueries(lineQueries, checksum, [&](uint64_t k) {
+        uint64_t begin = lines.selectLine(k);
+        uint64_t end = (k < lines.numNewlines()) ? lines.selectLine(k + 1) - 1 : cfg->textLength;
+        lines.get(out, begin, end);
+        return end - begin;
+    });
+    double getLineTime = timeLineQueries(lineQueries, checksum,
+        [&lines, &line](uint64_t k) { lines.getLine(k, line); return line.size(); });
+    delete[] out;
+
+    std::cerr << "average line length: " << (double) lineLength / numQueries << std::endl;
+    std::cerr << "average selectLine time: " << selectTime << "[ns]" << std::endl;
+    std::cerr << "average lineOf time: " << lineOfTime << "[ns]" << std::endl;
+    std::cerr << "average select+extract line time: " << extractTime << "[ns]" << std::endl;
+    std::cerr << "average getLine time: " << getLineTime << "[ns]" << std::endl;
+    std::cerr << "checksum: " << checksum << std::endl;
+}
+
+}
@@ -0,0 +1,65 @@
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "bench/bench.hpp"
+#include "cfg/pattern_matcher.hpp"
+#include "cfg/random_access_v2_sd.hpp"
+
+namespace bench {
+
+void patternMatching(cfg::CFG* cfg, xoroshiro::xoroshiro128plus_engine& eng, uint32_t patternSize, uint32_t numQueries)
+{
+    // decompress the text for the baseline and to sample patterns from
+    auto startTime = std::chrono::steady_clock::now();
+    std::string text(cfg->textLength, 0);
+    {
+        cfg::RandomAccessV2SD<> sd(cfg);
+        sd.get(text.data(), 0, cfg->textLength);
+    }
+    auto endTime = std::chrono::steady_clock::now();
+    double decompressTime = std::chrono::duration_cast<std::chrono::microseconds>(endTime - startTime).count();
+
+    std::uniform_int_distribution<uint64_t> dist(0, cfg->textLength - patternSize);
+    double countTime = 0, locateTime = 0, scanTime = 0;
+    uint64_t memSize = 0, numOccurrences = 0;
+    for (uint32_t i = 0; i < numQueries; i++) {
+        std::string pattern = text.substr(dist(eng), patternSize);
+
+        startTime = std::chrono::steady_clock::now();
+        cfg::PatternMatcher matcher(cfg, pattern);
+        uint64_t count = matcher.count();
+        endTime = std::chrono::steady_clock::now();
+        countTime += std::chrono::duration_cast<std::chrono::microseconds>(endTime - startTime).count();
+
+        startTime = std::chrono::steady_clock::now();
+        std::vector<uint64_t> occurrences = matcher.locate();
+        endTime = std::chrono::steady_clock::now();
+        locateTime += std::chrono::duration_cast<std::chrono::microseconds>(endTime - startTime).count();
+
+        startTime = std::chrono::steady_clock::now();
+        std::vector<uint64_t> scanned;
+        for (size_t p = text.find(pattern); p != std::string::npos; p = text.find(pattern, p + 1)) {
+            scanned.push_back(p);
+        }
+        endTime = std::chrono::steady_clock::now();
+        scanTime += std::chrono::duration_cast<std::chrono::microseconds>(endTime - startTime).count();
+
+        if (count != scanned.size() || occurrences != scanned) {
+            throw std::runtime_error("grammar occurrences disagree with the text for \"" + pattern + "\"");
+        }
+        memSize = std::max(memSize, matcher.memSize());
+        numOccurrences += count;
+    }
+
+    std::cerr << "max matcher mem size: " << memSize << std::endl;
+    std::cerr << "average occurrences: " << (double) numOccurrences / numQueries << std::endl;
+    std::cerr << "decompression time: " << decompressTime << "[µs]" << std::endl;
+    std::cerr << "average grammar count time: " << countTime / numQueries << "[µs]" << std::endl;
+    std::cerr << "average grammar locate time: " << (countTime + locateTime) / numQueries << "[µs]" << std::endl;
+    std::cerr << "average text scan time: " << scanTime / numQueries << "[µs]" << std::endl;
+}
+
+}
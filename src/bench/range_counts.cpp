@@ -0,0 +1,113 @@
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "bench/bench.hpp"
+#include "cfg/random_access_v2_counts.hpp"
+
+namespace bench {
+
+void rangeCounts(cfg::CFG* cfg, xoroshiro::xoroshiro128plus_engine& eng, uint32_t querySize, uint32_t numQueries)
+{
+    const int numSymbols = 16;
+
+    // count the most frequent bytes in the text
+    std::string text(cfg->textLength, 0);
+    {
+        cfg::RandomAccessV2SD<> sd(cfg);
+        sd.get(text.data(), 0, cfg->textLength);
+    }
+    std::vector<uint64_t> frequencies(cfg::CFG::ALPHABET_SIZE, 0);
+    for (unsigned char c : text) {
+        frequencies[c]++;
+    }
+    std::vector<int> bytes(cfg::CFG::ALPHABET_SIZE);
+    for (int c = 0; c < cfg::CFG::ALPHABET_SIZE; c++) {
+        bytes[c] = c;
+    }
+    std::stable_sort(bytes.begin(), bytes.end(), [&frequencies](int a, int b) { return frequencies[a] > frequencies[b]; });
+    std::string symbols;
+    for (int s = 0; s < numSymbols; s++) {
+        symbols += (char) bytes[s];
+    }
+
+    cfg::RandomAccessV2Counts<> counts(cfg, symbols);
+    std::cerr << "counted symbols: " << numSymbols << std::endl;
+    std::cerr << "counts mem size: " << counts.countsMemSize() << std::endl;
+    std::cerr << "countsv2 mem size: " << counts.memSize() << std::endl;
+
+    std::uniform_int_distribution<uint64_t> dist(0, cfg->textLength - querySize);
+    std::vector<uint64_t> queries(numQueries);
+    for (uint32_t i = 0; i < numQueries; i++) {
+        queries[i] = dist(eng);
+    }
+
+    // make sure the histograms are correct before timing them
+    uint64_t histogram[numSymbols];
+    std::vector<uint64_t> expected(cfg::CFG::ALPHABET_SIZE);
+    for (uint64_t begin : queries) {
+        std::fill(expected.begin(), expected.end(), 0);
+        for (uint64_t i = begin; i < begin + querySize; i++) {
+            expected[(unsigned char) text[i]]++;
+        }
+        counts.histogram(begin, begin + querySize, histogram);
+        for (int s = 0; s < numSymbols; s++) {
+            if (histogram[s] != expected[bytes[s]]) {
+                throw std::runtime_error("histogram disagrees with the text");
+            }
+        }
+        if (counts.count(symbols[0], begin, begin + querySize) != expected[bytes[0]]) {
+            throw std::runtime_error("count disagrees with the text");
+        }
+    }
+
+    uint32_t numLoops = 11;
+    std::vector<double> extractTimes(numLoops), histogramTimes(numLoops), countTimes(numLoops);
+    uint64_t checksum = 0;
+    char* out = new char[querySize];
+    for (int l = 0; l < numLoops; l++) {
+        auto startTime = std::chrono::steady_clock::now();
+        for (uint64_t begin : queries) {
+            counts.get(out, begin, begin + querySize);
+            std::fill(expected.begin(), expected.end(), 0);
+            for (uint64_t i = 0; i < querySize; i++) {
+                expected[(unsigned char) out[i]]++;
+            }
+            for (int s = 0; s < numSymbols; s++) {
+                checksum += expected[bytes[s]];
+            }
+        }
+        auto endTime = std::chrono::steady_clock::now();
+        extractTimes[l] = (double) std::chrono::duration_cast<std::chrono::nanoseconds>(endTime - startTime).count() / numQueries;
+
+        startTime = std::chrono::steady_clock::now();
+        for (uint64_t begin : queries) {
+            counts.histogram(begin, begin + querySize, histogram);
+            for (int s = 0; s < numSymbols; s++) {
+                checksum += histogram[s];
+            }
+        }
+        endTime = std::chrono::steady_clock::now();
+        histogramTimes[l] = (double) std::chrono::duration_cast<std::chrono::nanoseconds>(endTime - startTime).count() / numQueries;
+
+        startTime = std::chrono::steady_clock::now();
+        for (uint64_t begin : queries) {
+            checksum += counts.count(symbols[0], begin, begin + querySize);
+        }
+        endTime = std::chrono::steady_clock::now();
+        countTimes[l] = (double) std::chrono::duration_cast<std::chrono::nanoseconds>(endTime - startTime).count() / numQueries;
+    }
+    delete[] out;
+    std::sort(extractTimes.begin(), extractTimes.end());
+    std::sort(histogramTimes.begin(), histogramTimes.end());
+    std::sort(countTimes.begin(), countTimes.end());
+
+    std::cerr << "average extract+count time: " << extractTimes[numLoops / 2] << "[ns]" << std::endl;
+    std::cerr << "average histogram time: " << histogramTimes[numLoops / 2] << "[ns]" << std::endl;
+    std::cerr << "average single symbol count time: " << countTimes[numLoops / 2] << "[ns]" << std::endl;
+    std::cerr << "checksum: " << checksum << std::endl;
+}
+
+}
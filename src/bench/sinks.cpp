@@ -0,0 +1,152 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>  // memcmp
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+#include "bench/bench.hpp"
+#include "cfg/parallel_extractor.hpp"
+#include "cfg/random_access_v2_sd.hpp"
+#include "io/sink.hpp"
+
+namespace bench {
+
+/**
+ * Times writing the whole text and returns the median time in seconds.
+ */
+template <class Write>
+double timeWrite(Write write)
+{
+    // fewer loops than the other benchmarks since each one writes the whole text
+    uint32_t numLoops = 5;
+    std::vector<double> times(numLoops);
+    for (int i = 0; i < numLoops; i++) {
+        auto startTime = std::chrono::steady_clock::now();
+        write();
+        auto endTime = std::chrono::steady_clock::now();
+        times[i] = std::chrono::duration_cast<std::chrono::nanoseconds>(endTime - startTime).count() / 1e9;
+    }
+    std::sort(times.begin(), times.end());
+    return times[numLoops / 2];
+}
+
+/**
+ * Writes the text to a pipe while another thread reads it and checks it against the expected text.
+ */
+template <class MakeSink>
+void checkSink(MakeSink makeSink, cfg::ParallelExtractor& extractor, const char* expected, uint64_t length)
+{
+    int fds[2];
+    if (pipe(fds) == -1) {
+        throw std::runtime_error("failed to create pipe");
+    }
+
+    bool correct = true;
+    std::thread reader([&]() {
+        std::vector<char> buffer(1 << 16);
+        uint64_t position = 0;
+        ssize_t n;
+        while ((n = read(fds[0], buffer.data(), buffer.size())) > 0) {
+            if (position + n > length || std::memcmp(buffer.data(), expected + position, n) != 0) {
+                correct = false;
+            }
+            position += n;
+        }
+        correct &= position == length;
+    });
+    io::Sink* sink = makeSink(fds[1]);
+    extractor.extract(*sink, 0, length);
+    delete sink;
+    close(fds[1]);
+    reader.join();
+    close(fds[0]);
+
+    if (!correct) {
+        throw std::runtime_error("sink output disagrees with random access");
+    }
+}
+
+void sinks(cfg::CFG* cfg)
+{
+    uint64_t length = cfg->textLength;
+    char* expected = new char[length];
+    cfg::RandomAccessV2SD<> sd(cfg);
+    sd.get(expected, 0, length);
+    cfg::ParallelExtractor extractor(cfg);
+
+    // check the sinks that write to file descriptors
+    checkSink([](int fd) { return new io::FdSink(fd); }, extractor, expected, length);
+    checkSink([](int fd) { return new io::WritevSink(fd); }, extractor, expected, length);
+    checkSink([](int fd) { return new io::VmspliceSink(fd); }, extractor, expected, length);
+
+    int devNull = open("/dev/null", O_WRONLY);
+    if (devNull == -1) {
+        throw std::runtime_error("failed to open /dev/null");
+    }
+    double time;
+
+    // writing one character at a time like RandomAccess::get
+    std::ofstream stream("/dev/null");
+    time = timeWrite([&]() {
+        for (uint64_t i = 0; i < length; i++) {
+            stream << expected[i];
+        }
+        stream.flush();
+    });
+    std::cerr << "ostream per character (write only): " << time << "[s], " << length / time / 1e9 << "[GB/s]" << std::endl;
+    char* out = new char[length];
+    time = timeWrite([&]() {
+        io::BufferSink sink(out, length);
+        sd.get(sink, 0, length);
+    });
+    if (std::memcmp(out, expected, length) != 0) {
+        throw std::runtime_error("buffer sink output disagrees with random access");
+    }
+    std::cerr << "SD get to buffer sink: " << time << "[s], " << length / time / 1e9 << "[GB/s]" << std::endl;
+    time = timeWrite([&]() {
+        io::FdSink sink(devNull);
+        sd.get(sink, 0, length);
+        sink.flush();
+    });
+    std::cerr << "SD get to fd sink: " << time << "[s], " << length / time / 1e9 << "[GB/s]" << std::endl;
+    delete[] out;
+
+    // extracting windows in parallel and writing them as blocks
+    time = timeWrite([&]() {
+        io::FdSink sink(devNull);
+        extractor.extract(sink, 0, length);
+    });
+    std::cerr << "parallel extraction to fd sink: " << time << "[s], " << length / time / 1e9 << "[GB/s]" << std::endl;
+    time = timeWrite([&]() {
+        io::WritevSink sink(devNull);
+        extractor.extract(sink, 0, length);
+    });
+    std::cerr << "parallel extraction to writev sink: " << time << "[s], " << length / time / 1e9 << "[GB/s]" << std::endl;
+
+    // the reader splices the pipe to /dev/null so the pages are never copied
+    int fds[2];
+    if (pipe(fds) == -1) {
+        throw std::runtime_error("failed to create pipe");
+    }
+    io::VmspliceSink* vmspliceSink = new io::VmspliceSink(fds[1]);
+    std::thread reader([&]() {
+        while (splice(fds[0], NULL, devNull, NULL, 1 << 20, SPLICE_F_MOVE) > 0);
+    });
+    time = timeWrite([&]() {
+        extractor.extract(*vmspliceSink, 0, length);
+    });
+    delete vmspliceSink;
+    close(fds[1]);
+    reader.join();
+    close(fds[0]);
+    std::cerr << "parallel extraction to vmsplice sink: " << time << "[s], " << length / time / 1e9 << "[GB/s]" << std::endl;
+
+    close(devNull);
+    delete[] expected;
+}
+
+}
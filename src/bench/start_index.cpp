@@ -0,0 +1,203 @@
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "bench/bench.hpp"
+#include "cfg/random_access_amt.hpp"
+#include "cfg/start_index_eytzinger.hpp"
+#include "cfg/start_index_pgm.hpp"
+#include "cfg/start_index_sd.hpp"
+
+namespace bench {
+
+uint64_t* startPositions(cfg::CFG* cfg)
+{
+    uint64_t* ruleSizes = cfg->expansionSizes();
+
+    uint64_t* positions = new uint64_t[cfg->startSize];
+    uint64_t pos = 0;
+    for (int i = 0; i < cfg->startSize; i++) {
+        positions[i] = pos;
+        pos += ruleSizes[cfg->rules[cfg->startRule][i]];
+    }
+
+    delete[] ruleSizes;
+    return positions;
+}
+
+/**
+ * Times a start index lookup method and returns the median of the average lookup times in
+ * nanoseconds.
+ */
+template <class Lookup>
+double timeLookups(std::vector<uint64_t>& queries, uint64_t& checksum, Lookup lookup)
+{
+    uint32_t numLoops = 11;
+    std::vector<double> times(numLoops);
+    int rank;
+    uint64_t select;
+    for (int i = 0; i < numLoops; i++) {
+        auto startTime = std::chrono::steady_clock::now();
+        for (uint64_t q : queries) {
+            lookup(q, rank, select);
+            checksum += rank + select;
+        }
+        auto endTime = std::chrono::steady_clock::now();
+        double duration = std::chrono::duration_cast<std::chrono::nanoseconds>(endTime - startTime).count();
+        times[i] = duration / queries.size();
+    }
+    std::sort(times.begin(), times.end());
+    return times[numLoops / 2];
+}
+
+/**
+ * Builds a start index over the given positions, prints its size and the median of its average
+ * predecessor times, and checks its answers against a reference index.
+ */
+template <class StartIndex>
+void timeStartIndex(std::string name, const uint64_t* positions, uint64_t size, uint64_t textLength, std::vector<uint64_t>& queries, cfg::StartIndexSD& reference)
+{
+    StartIndex index(positions, size, textLength);
+
+    int rank1, rank2;
+    uint64_t select1, select2;
+    for (uint64_t q : queries) {
+        reference.rankSelect(q, rank1, select1);
+        index.predecessor(q, rank2, select2);
+        if (rank1 != rank2 || select1 != select2) {
+            throw std::runtime_error(name + " predecessor disagrees with rank/select");
+        }
+    }
+
+    uint64_t checksum = 0;
+    double time = timeLookups(queries, checksum,
+        [&index](uint64_t i, int& rank, uint64_t& select) { index.predecessor(i, rank, select); });
+    std::cerr << "\t" << name << ": " << index.memSize() << " bytes, " << time << "[ns] (" << checksum << ")" << std::endl;
+}
+
+/**
+ * Prints the size of the grammar's AMT start index and the median of its average lookup times when
+ * the queries are answered in batches of increasing size, and checks its answers against a
+ * reference index.
+ */
+static void timeAMTBatches(cfg::CFG* cfg, std::vector<uint64_t>& queries, cfg::StartIndexSD& reference)
+{
+    cfg::RandomAccessAMT amt(cfg);
+    std::vector<uint64_t> ranks(queries.size()), selects(queries.size());
+    amt.rankSelectBatch(queries.data(), ranks.data(), selects.data(), queries.size());
+    int rank;
+    uint64_t select;
+    for (uint64_t j = 0; j < queries.size(); j++) {
+        reference.rankSelect(queries[j], rank, select);
+        if ((uint64_t) rank != ranks[j] || select != selects[j]) {
+            throw std::runtime_error("amt batch disagrees with rank/select");
+        }
+    }
+
+    uint32_t numLoops = 11;
+    std::vector<double> times(numLoops);
+    for (uint64_t batchSize : {(uint64_t) 1, (uint64_t) 64, (uint64_t) 1024, (uint64_t) queries.size()}) {
+        uint64_t checksum = 0;
+        for (int i = 0; i < numLoops; i++) {
+            auto startTime = std::chrono::steady_clock::now();
+            for (uint64_t begin = 0; begin < queries.size(); begin += batchSize) {
+                uint64_t n = std::min(batchSize, queries.size() - begin);
+                amt.rankSelectBatch(queries.data() + begin, ranks.data() + begin, selects.data() + begin, n);
+            }
+            auto endTime = std::chrono::steady_clock::now();
+            double duration = std::chrono::duration_cast<std::chrono::nanoseconds>(endTime - startTime).count();
+            times[i] = duration / queries.size();
+            for (uint64_t j = 0; j < queries.size(); j++) {
+                checksum += ranks[j] + selects[j];
+            }
+        }
+        std::sort(times.begin(), times.end());
+        std::cerr << "\tamt batches of " << batchSize << ": " << amt.memSize() << " bytes, " << times[numLoops / 2] << "[ns] (" << checksum << ")" << std::endl;
+    }
+}
+
+void startIndex(cfg::CFG* cfg, xoroshiro::xoroshiro128plus_engine& eng, uint32_t numQueries)
+{
+    uint64_t* positions = startPositions(cfg);
+    cfg::StartIndexSD sd(positions, cfg->startSize, cfg->textLength);
+    delete[] positions;
+
+    std::uniform_int_distribution<uint64_t> dist(0, cfg->textLength - 1);
+    std::vector<uint64_t> queries(numQueries);
+    for (uint32_t i = 0; i < numQueries; i++) {
+        queries[i] = dist(eng);
+    }
+
+    // make sure the methods agree before timing them
+    int rank1, rank2;
+    uint64_t select1, select2;
+    for (uint64_t q : queries) {
+        sd.rankSelect(q, rank1, select1);
+        sd.predecessor(q, rank2, select2);
+        if (rank1 != rank2 || select1 != select2) {
+            throw std::runtime_error("predecessor and rank/select disagree");
+        }
+    }
+
+    uint64_t checksum = 0;
+    double rankSelectTime = timeLookups(queries, checksum,
+        [&sd](uint64_t i, int& rank, uint64_t& select) { sd.rankSelect(i, rank, select); });
+    double predecessorTime = timeLookups(queries, checksum,
+        [&sd](uint64_t i, int& rank, uint64_t& select) { sd.predecessor(i, rank, select); });
+
+    std::cerr << "sd mem size: " << sd.memSize() << std::endl;
+    std::cerr << "average SD rank+select time: " << rankSelectTime << "[ns]" << std::endl;
+    std::cerr << "average SD predecessor time: " << predecessorTime << "[ns]" << std::endl;
+    std::cerr << "checksum: " << checksum << std::endl;
+
+    positions = startPositions(cfg);
+    timeStartIndex<cfg::StartIndexEytzinger<1>>("eytzinger", positions, cfg->startSize, cfg->textLength, queries, sd);
+    timeStartIndex<cfg::StartIndexEytzinger<16>>("eytzinger/16", positions, cfg->startSize, cfg->textLength, queries, sd);
+    timeStartIndex<cfg::StartIndexPGM<16>>("pgm/16", positions, cfg->startSize, cfg->textLength, queries, sd);
+    timeStartIndex<cfg::StartIndexPGM<64>>("pgm/64", positions, cfg->startSize, cfg->textLength, queries, sd);
+    cfg::StartIndexPGM<64> pgm(positions, cfg->startSize, cfg->textLength);
+    std::cerr << "pgm/64 segments: " << pgm.numSegments() << ", model size: " << pgm.modelSize() << " bytes" << std::endl;
+    delete[] positions;
+    timeAMTBatches(cfg, queries, sd);
+}
+
+void startIndexSweep(cfg::CFG* cfg, xoroshiro::xoroshiro128plus_engine& eng, uint32_t numQueries)
+{
+    // draw the synthetic phrase lengths from the grammar's start rule
+    uint64_t* positions = startPositions(cfg);
+    std::vector<uint64_t> lengths(cfg->startSize);
+    for (int i = 0; i < cfg->startSize; i++) {
+        uint64_t next = (i + 1 < cfg->startSize) ? positions[i + 1] : cfg->textLength;
+        lengths[i] = next - positions[i];
+    }
+    delete[] positions;
+    std::uniform_int_distribution<uint64_t> lengthDist(0, lengths.size() - 1);
+
+    for (uint64_t size = 1 << 10; size <= 1 << 24; size <<= 2) {
+        positions = new uint64_t[size];
+        uint64_t textLength = 0;
+        for (uint64_t i = 0; i < size; i++) {
+            positions[i] = textLength;
+            textLength += lengths[lengthDist(eng)];
+        }
+        std::uniform_int_distribution<uint64_t> dist(0, textLength - 1);
+        std::vector<uint64_t> queries(numQueries);
+        for (uint32_t i = 0; i < numQueries; i++) {
+            queries[i] = dist(eng);
+        }
+
+        std::cerr << "start size: " << size << ", text length: " << textLength << std::endl;
+        cfg::StartIndexSD sd(positions, size, textLength);
+        timeStartIndex<cfg::StartIndexSD>("sd", positions, size, textLength, queries, sd);
+        timeStartIndex<cfg::StartIndexEytzinger<1>>("eytzinger", positions, size, textLength, queries, sd);
+        timeStartIndex<cfg::StartIndexEytzinger<16>>("eytzinger/16", positions, size, textLength, queries, sd);
+        timeStartIndex<cfg::StartIndexEytzinger<64>>("eytzinger/64", positions, size, textLength, queries, sd);
+        timeStartIndex<cfg::StartIndexPGM<16>>("pgm/16", positions, size, textLength, queries, sd);
+        timeStartIndex<cfg::StartIndexPGM<64>>("pgm/64", positions, size, textLength, queries, sd);
+        delete[] positions;
+    }
+}
+
+}
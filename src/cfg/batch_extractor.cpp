@@ -0,0 +1,109 @@
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include "cfg/batch_extractor.hpp"
+#include "io/bounded_queue.hpp"
+#include "io/range_reader.hpp"
+#include "io/sink.hpp"
+
+namespace cfg {
+
+// public
+
+uint64_t BatchExtractor::run(int inFd, int outFd)
+{
+    io::BoundedQueue<std::vector<Range>> ranges(BatchExtractor::QUEUE_CAPACITY);
+    io::BoundedQueue<std::vector<char>> records(BatchExtractor::QUEUE_CAPACITY);
+    error = nullptr;
+
+    // remember the first error and stop the other stages
+    auto fail = [&]() {
+        {
+            std::lock_guard<std::mutex> lock(errorMutex);
+            if (!error) error = std::current_exception();
+        }
+        ranges.close();
+        records.close();
+    };
+
+    // parse the ranges into batches
+    std::thread parser([&]() {
+        try {
+            io::RangeReader reader(inFd);
+            std::vector<Range> batch;
+            uint64_t begin, end, batchBytes = 0, numRanges = 0;
+            while (reader.next(begin, end)) {
+                numRanges++;
+                if (begin > end || end > cfg->textLength) {
+                    throw std::runtime_error("range " + std::to_string(numRanges) + " is out of bounds");
+                }
+                batch.push_back({begin, end});
+                batchBytes += sizeof(uint64_t) + end - begin;
+                if (batch.size() == BatchExtractor::BATCH_RANGES || batchBytes >= BatchExtractor::BATCH_BYTES) {
+                    if (!ranges.push(std::move(batch))) return;
+                    batch = std::vector<Range>();
+                    batchBytes = 0;
+                }
+            }
+            if (!batch.empty()) ranges.push(std::move(batch));
+            ranges.close();
+        } catch (...) {
+            fail();
+        }
+    });
+
+    // write the records through a large buffer; batches larger than it are written directly
+    std::thread writer([&]() {
+        try {
+            io::FdSink sink(outFd, 1 << 22);
+            std::vector<char> block;
+            while (records.pop(block)) {
+                sink.write(block.data(), block.size());
+            }
+            sink.flush();
+        } catch (...) {
+            fail();
+        }
+    });
+
+    // query each batch into one block of records
+    uint64_t numRecords = 0;
+    try {
+        std::vector<Range> batch;
+        uint64_t size, length;
+        char* record;
+        while (ranges.pop(batch)) {
+            size = 0;
+            for (const Range& range : batch) {
+                size += sizeof(uint64_t) + range.end - range.begin;
+            }
+            std::vector<char> block(size);
+            record = block.data();
+            for (const Range& range : batch) {
+                length = range.end - range.begin;
+                for (int i = 0; i < 8; i++) {
+                    record[i] = (char) (length >> (8 * i));
+                }
+                if (length > 0) {
+                    index.get(record + sizeof(uint64_t), range.begin, range.end);
+                }
+                record += sizeof(uint64_t) + length;
+            }
+            if (!records.push(std::move(block))) break;
+            numRecords += batch.size();
+        }
+        records.close();
+    } catch (...) {
+        fail();
+    }
+
+    parser.join();
+    writer.join();
+    if (error) {
+        std::rethrow_exception(error);
+    }
+
+    return numRecords;
+}
+
+}
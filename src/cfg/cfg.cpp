@@ -118,6 +118,26 @@ void CFG::postProcess()
     delete[] ruleSizes;
 }
 
+// public
+
+uint64_t* CFG::expansionSizes()
+{
+    uint64_t* sizes = new uint64_t[startRule];
+    for (int i = 0; i < CFG::ALPHABET_SIZE; i++) {
+        sizes[i] = 1;
+    }
+
+    // rules are ordered by expansion length so a rule's characters always come before it
+    int c;
+    for (int i = CFG::ALPHABET_SIZE; i < startRule; i++) {
+        sizes[i] = 0;
+        for (int j = 0; (c = rules[i][j]) != CFG::DUMMY_CODE; j++) {
+            sizes[i] += sizes[c];
+        }
+    }
+    return sizes;
+}
+
 // load grammars
 
 CFG* CFG::fromMrRepairFile(std::string filename)
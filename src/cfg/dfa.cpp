@@ -0,0 +1,52 @@
+#include <stdexcept>
+#include "cfg/dfa.hpp"
+
+namespace cfg {
+
+// construction
+
+DFA::DFA(int numStates, int startState, std::vector<int> transitions, std::vector<bool> accepting):
+    numStates(numStates),
+    startState(startState),
+    transitions(transitions),
+    accepting(accepting)
+{
+    if (transitions.size() != (size_t) numStates * CFG::ALPHABET_SIZE || accepting.size() != (size_t) numStates) {
+        throw std::runtime_error("DFA tables don't match the number of states");
+    }
+    if (startState < 0 || startState >= numStates) {
+        throw std::runtime_error("DFA start state is out of range");
+    }
+}
+
+DFA DFA::fromPattern(std::string pattern)
+{
+    if (pattern.empty()) {
+        throw std::runtime_error("cannot build a DFA for an empty pattern");
+    }
+
+    // state i means the last i characters read are the pattern's first i characters
+    int m = pattern.size();
+    std::vector<int> transitions((m + 1) * CFG::ALPHABET_SIZE, 0);
+    std::vector<bool> accepting(m + 1, false);
+    accepting[m] = true;
+
+    // fallback is the state the automaton would be in after reading pattern[1, i)
+    int fallback = 0;
+    for (int i = 0; i <= m; i++) {
+        for (int c = 0; c < CFG::ALPHABET_SIZE; c++) {
+            transitions[i * CFG::ALPHABET_SIZE + c] = transitions[fallback * CFG::ALPHABET_SIZE + c];
+        }
+        if (i < m) {
+            int c = (unsigned char) pattern[i];
+            transitions[i * CFG::ALPHABET_SIZE + c] = i + 1;
+            if (i > 0) {
+                fallback = transitions[fallback * CFG::ALPHABET_SIZE + c];
+            }
+        }
+    }
+
+    return DFA(m + 1, 0, transitions, accepting);
+}
+
+}
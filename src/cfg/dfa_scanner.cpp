@@ -0,0 +1,95 @@
+#include <algorithm>
+#include <stdexcept>
+#include "cfg/dfa_scanner.hpp"
+
+namespace cfg {
+
+// construction
+
+DFAScanner::DFAScanner(CFG* cfg, const DFA& dfa): cfg(cfg), dfa(dfa)
+{
+    numStates = dfa.getNumStates();
+    if ((uint64_t) numStates >= (UNKNOWN >> 1)) {
+        throw std::runtime_error("too many DFA states to memoize");
+    }
+
+    ruleSizes = cfg->expansionSizes();
+
+    uint64_t memoSize = (uint64_t) cfg->numRules * numStates;
+    memo = new uint32_t[memoSize];
+    const uint32_t unknown = DFAScanner::UNKNOWN;
+    std::fill(memo, memo + memoSize, unknown);
+    numMemoized = 0;
+}
+
+// destruction
+
+DFAScanner::~DFAScanner()
+{
+    delete[] ruleSizes;
+    delete[] memo;
+}
+
+// private
+
+uint32_t DFAScanner::computeTransition(int rule, int state)
+{
+    bool accepts = false;
+    int c;
+    uint32_t t;
+    for (int i = 0; (c = cfg->rules[rule][i]) != CFG::DUMMY_CODE; i++) {
+        if (c < CFG::ALPHABET_SIZE) {
+            state = dfa.next(state, c);
+            accepts |= dfa.isAccepting(state);
+        } else {
+            t = transition(c, state);
+            accepts |= t & 1;
+            state = t >> 1;
+        }
+    }
+    return (((uint32_t) state) << 1) | accepts;
+}
+
+// public
+
+uint64_t DFAScanner::memSize()
+{
+    uint64_t ruleSizesSize = sizeof(uint64_t) * cfg->startRule;
+    uint64_t memoSize = sizeof(uint32_t) * cfg->numRules * numStates;
+    return ruleSizesSize + memoSize;
+}
+
+void DFAScanner::fill()
+{
+    // a rule's characters are memoized before it so computing a transition never recurses
+    for (int i = CFG::ALPHABET_SIZE; i < cfg->startRule; i++) {
+        for (int state = 0; state < numStates; state++) {
+            transition(i, state);
+        }
+    }
+}
+
+// scanning
+
+bool DFAScanner::firstMatch(uint64_t& position)
+{
+    bool found = false;
+    forEachMatch([&found, &position](uint64_t p) {
+        found = true;
+        position = p;
+        return false;
+    });
+    return found;
+}
+
+uint64_t DFAScanner::count()
+{
+    uint64_t count = 0;
+    forEachMatch([&count](uint64_t) {
+        count++;
+        return true;
+    });
+    return count;
+}
+
+}
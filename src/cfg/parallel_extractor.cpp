@@ -0,0 +1,224 @@
+#include <algorithm>
+#include <atomic>
+#include <cstring>  // memcpy
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <thread>
+#include <unistd.h>
+#include "cfg/parallel_extractor.hpp"
+
+namespace cfg {
+
+// construction
+
+ParallelExtractor::ParallelExtractor(CFG* cfg, int numThreads): cfg(cfg), numThreads(numThreads)
+{
+    if (this->numThreads <= 0) {
+        this->numThreads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    ruleSizes = cfg->expansionSizes();
+
+    startPositions = new uint64_t[cfg->startSize + 1];
+    startPositions[0] = 0;
+    for (int i = 0; i < cfg->startSize; i++) {
+        startPositions[i + 1] = startPositions[i] + ruleSizes[cfg->rules[cfg->startRule][i]];
+    }
+}
+
+// destruction
+
+ParallelExtractor::~ParallelExtractor()
+{
+    delete[] ruleSizes;
+    delete[] startPositions;
+}
+
+// private
+
+std::vector<uint64_t> ParallelExtractor::split(uint64_t begin, uint64_t end)
+{
+    uint64_t length = end - begin;
+    uint64_t numPieces = std::min((uint64_t) numThreads * PIECES_PER_THREAD, length / MIN_PIECE_SIZE);
+    numPieces = std::max(numPieces, (uint64_t) 1);
+    uint64_t pieceSize = length / numPieces;
+
+    std::vector<uint64_t> splits = {begin};
+    uint64_t position, phrase;
+    for (uint64_t i = 1; i < numPieces; i++) {
+        position = begin + i * pieceSize;
+        // start at the phrase boundary before the position to avoid descending into the phrase
+        phrase = *(std::upper_bound(startPositions, startPositions + cfg->startSize + 1, position) - 1);
+        if (position - phrase <= pieceSize / 4) {
+            position = phrase;
+        }
+        if (position > splits.back()) {
+            splits.push_back(position);
+        }
+    }
+    splits.push_back(end);
+
+    return splits;
+}
+
+void ParallelExtractor::decode(char* out, uint64_t begin, uint64_t end, uint64_t offset, std::vector<Frame>& stack, Memo* memo)
+{
+    const uint64_t memoMask = (((uint64_t) 1) << MEMO_BITS) - 1;
+    stack.clear();
+
+    // get the start rule character to start parsing at
+    int rule = cfg->startRule;
+    int i = std::upper_bound(startPositions, startPositions + cfg->startSize + 1, begin) - startPositions - 1;
+    uint64_t ruleBegin = ParallelExtractor::PARTIAL;
+
+    // descend the parse tree to the correct start position
+    uint64_t size, ignore = begin - startPositions[i];
+    int c;
+    while (ignore > 0) {
+        c = cfg->rules[rule][i];
+        size = ruleSizes[c];
+        if (size > ignore) {
+            stack.push_back({rule, i + 1, ruleBegin});
+            rule = c;
+            i = 0;
+        } else {
+            ignore -= size;
+            i++;
+        }
+    }
+
+    // decode the piece
+    uint64_t j = offset, jEnd = offset + (end - begin);
+    while (j < jEnd) {
+        c = cfg->rules[rule][i];
+        // end of rule; remember where its expansion is if it's all in the output
+        if (c == CFG::DUMMY_CODE) {
+            if (ruleBegin != ParallelExtractor::PARTIAL) {
+                memo[rule & memoMask] = {rule, ruleBegin};
+            }
+            rule = stack.back().rule;
+            i = stack.back().index;
+            ruleBegin = stack.back().begin;
+            stack.pop_back();
+        // terminal character
+        } else if (c < CFG::ALPHABET_SIZE) {
+            out[j++] = (char) c;
+            i++;
+        // non-terminal character
+        } else {
+            size = ruleSizes[c];
+            if (j + size <= jEnd) {
+                // copy the expansion if it was output before
+                Memo& m = memo[c & memoMask];
+                if (m.rule == c) {
+                    std::memcpy(out + j, out + m.begin, size);
+                    j += size;
+                    i++;
+                    continue;
+                }
+                stack.push_back({rule, i + 1, ruleBegin});
+                ruleBegin = j;
+            } else {
+                stack.push_back({rule, i + 1, ruleBegin});
+                ruleBegin = ParallelExtractor::PARTIAL;
+            }
+            rule = c;
+            i = 0;
+        }
+    }
+}
+
+// public
+
+uint64_t ParallelExtractor::memSize()
+{
+    return sizeof(uint64_t) * (cfg->startRule + cfg->startSize + 1);
+}
+
+// extraction
+
+void ParallelExtractor::extract(char* out, uint64_t begin, uint64_t end)
+{
+    if (begin > end || end > cfg->textLength) {
+        throw std::runtime_error("begin/end out of bounds");
+    }
+    if (begin == end) return;
+
+    std::vector<uint64_t> splits = split(begin, end);
+    uint64_t numPieces = splits.size() - 1;
+    std::atomic<uint64_t> nextPiece(0);
+
+    auto work = [&]() {
+        std::vector<Frame> stack;
+        stack.reserve(cfg->depth + 1);
+        Memo* memo = new Memo[((uint64_t) 1) << MEMO_BITS];
+        std::fill(memo, memo + (((uint64_t) 1) << MEMO_BITS), Memo{CFG::DUMMY_CODE, 0});
+        uint64_t p;
+        while ((p = nextPiece.fetch_add(1)) < numPieces) {
+            decode(out, splits[p], splits[p + 1], splits[p] - begin, stack, memo);
+        }
+        delete[] memo;
+    };
+
+    int threadsToStart = (int) std::min((uint64_t) numThreads, numPieces) - 1;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < threadsToStart; t++) {
+        threads.emplace_back(work);
+    }
+    work();
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+}
+
+void ParallelExtractor::extract(io::Sink& out, uint64_t begin, uint64_t end)
+{
+    if (begin > end || end > cfg->textLength) {
+        throw std::runtime_error("begin/end out of bounds");
+    }
+
+    const uint64_t maxWindowSize = ParallelExtractor::SINK_WINDOW_SIZE;
+    uint64_t windowSize = std::min(end - begin, maxWindowSize);
+    std::vector<char> window(windowSize);
+    uint64_t windowEnd;
+    for (uint64_t windowBegin = begin; windowBegin < end; windowBegin = windowEnd) {
+        windowEnd = std::min(windowBegin + windowSize, end);
+        extract(window.data(), windowBegin, windowEnd);
+        out.write(window.data(), windowEnd - windowBegin);
+        out.flush();
+    }
+}
+
+void ParallelExtractor::extractToFile(std::string filename, uint64_t begin, uint64_t end)
+{
+    if (begin > end || end > cfg->textLength) {
+        throw std::runtime_error("begin/end out of bounds");
+    }
+    uint64_t length = end - begin;
+
+    int fd = open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd == -1) {
+        throw std::runtime_error("failed to open " + filename);
+    }
+    if (ftruncate(fd, length) == -1) {
+        close(fd);
+        throw std::runtime_error("failed to resize " + filename);
+    }
+    if (length == 0) {
+        close(fd);
+        return;
+    }
+    void* mapped = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (mapped == MAP_FAILED) {
+        close(fd);
+        throw std::runtime_error("failed to map " + filename);
+    }
+
+    extract((char*) mapped, begin, end);
+
+    munmap(mapped, length);
+    close(fd);
+}
+
+}
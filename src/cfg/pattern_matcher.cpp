@@ -0,0 +1,186 @@
+#include <algorithm>
+#include <cstring>  // memcpy, memcmp
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+#include "cfg/pattern_matcher.hpp"
+
+namespace cfg {
+
+// construction
+
+PatternMatcher::PatternMatcher(CFG* cfg, std::string pattern): cfg(cfg), pattern(pattern)
+{
+    if (pattern.empty()) {
+        throw std::runtime_error("cannot match an empty pattern");
+    }
+    m = pattern.size();
+
+    // fingerprint the pattern
+    patternFingerprint = 0;
+    highestPower = 1;
+    for (uint64_t i = 0; i < m; i++) {
+        patternFingerprint = patternFingerprint * BASE + (unsigned char) pattern[i];
+        if (i > 0) highestPower *= BASE;
+    }
+
+    initializeCounts();
+}
+
+// destruction
+
+PatternMatcher::~PatternMatcher()
+{
+    delete[] ruleSizes;
+    delete[] counts;
+    delete[] crossings;
+}
+
+// private
+
+void PatternMatcher::initializeCounts()
+{
+    ruleSizes = new uint64_t[cfg->startRule + 1];
+    counts = new uint64_t[cfg->startRule + 1];
+    crossings = new std::vector<uint64_t>[cfg->startRule + 1];
+
+    // the first and last min(m-1, size) characters of each rule's expansion
+    uint64_t affixSize = m - 1;
+    char* prefixes = new char[(cfg->startRule + 1) * affixSize];
+    char* suffixes = new char[(cfg->startRule + 1) * affixSize];
+    for (int i = 0; i < CFG::ALPHABET_SIZE; i++) {
+        ruleSizes[i] = 1;
+        counts[i] = (m == 1 && (unsigned char) pattern[0] == i) ? 1 : 0;
+        if (affixSize > 0) {
+            prefixes[i * affixSize] = (char) i;
+            suffixes[i * affixSize] = (char) i;
+        }
+    }
+
+    // each rule is visited after its characters and the start rule last, so the sizes, counts and
+    // affixes of its characters are complete
+    char* window = new char[2 * affixSize];
+    int c, length;
+    uint64_t offset, boundary, windowSize, affixLength, take;
+    for (int i = CFG::ALPHABET_SIZE; i <= cfg->startRule; i++) {
+        int* rule = cfg->rules[i];
+        ruleSizes[i] = 0;
+        counts[i] = 0;
+        for (length = 0; (c = rule[length]) != CFG::DUMMY_CODE; length++) {
+            ruleSizes[i] += ruleSizes[c];
+            counts[i] += counts[c];
+        }
+        if (affixSize == 0) continue;
+
+        // the occurrences that begin in the j-th character and end after it
+        offset = 0;
+        for (int j = 0; j < length - 1; j++) {
+            c = rule[j];
+            offset += ruleSizes[c];
+            boundary = std::min(affixSize, ruleSizes[c]);
+            std::memcpy(window, suffixes + c * affixSize, boundary);
+            windowSize = boundary;
+            for (int k = j + 1; k < length && windowSize < boundary + affixSize; k++) {
+                take = std::min({affixSize, ruleSizes[rule[k]], boundary + affixSize - windowSize});
+                std::memcpy(window + windowSize, prefixes + rule[k] * affixSize, take);
+                windowSize += take;
+            }
+            findCrossings(window, windowSize, boundary, offset - boundary, crossings[i]);
+        }
+        crossings[i].shrink_to_fit();
+        counts[i] += crossings[i].size();
+
+        // compute the rule's prefix and suffix from its characters'
+        affixLength = std::min(affixSize, ruleSizes[i]);
+        offset = 0;
+        for (int j = 0; offset < affixLength; j++) {
+            take = std::min({affixSize, ruleSizes[rule[j]], affixLength - offset});
+            std::memcpy(prefixes + i * affixSize + offset, prefixes + rule[j] * affixSize, take);
+            offset += take;
+        }
+        offset = affixLength;
+        for (int j = length - 1; offset > 0; j--) {
+            c = rule[j];
+            take = std::min({affixSize, ruleSizes[c], offset});
+            std::memcpy(suffixes + i * affixSize + offset - take, suffixes + c * affixSize + std::min(affixSize, ruleSizes[c]) - take, take);
+            offset -= take;
+        }
+    }
+
+    // clean up
+    delete[] window;
+    delete[] prefixes;
+    delete[] suffixes;
+}
+
+void PatternMatcher::findCrossings(const char* window, uint64_t size, uint64_t boundary, uint64_t offset, std::vector<uint64_t>& occurrences)
+{
+    if (size < m) return;
+    uint64_t end = std::min(boundary, size - m + 1);
+
+    uint64_t fingerprint = 0;
+    for (uint64_t i = 0; i < m; i++) {
+        fingerprint = fingerprint * BASE + (unsigned char) window[i];
+    }
+    for (uint64_t i = 0; ; i++) {
+        // verify matching fingerprints to rule out collisions
+        if (fingerprint == patternFingerprint && std::memcmp(window + i, pattern.data(), m) == 0) {
+            occurrences.push_back(offset + i);
+        }
+        if (i + 1 >= end) break;
+        // roll the fingerprint forward one character
+        fingerprint = (fingerprint - (unsigned char) window[i] * highestPower) * BASE + (unsigned char) window[i + m];
+    }
+}
+
+// public
+
+uint64_t PatternMatcher::memSize()
+{
+    uint64_t crossingsSize = sizeof(std::vector<uint64_t>) * (cfg->startRule + 1);
+    for (int i = CFG::ALPHABET_SIZE; i <= cfg->startRule; i++) {
+        crossingsSize += sizeof(uint64_t) * crossings[i].capacity();
+    }
+    return 2 * sizeof(uint64_t) * (cfg->startRule + 1) + crossingsSize;
+}
+
+// pattern matching
+
+uint64_t PatternMatcher::count()
+{
+    return counts[cfg->startRule];
+}
+
+std::vector<uint64_t> PatternMatcher::locate()
+{
+    std::vector<uint64_t> occurrences;
+    occurrences.reserve(count());
+
+    // traverse the parse tree, only descending into rules that contain occurrences
+    std::vector<std::pair<int, uint64_t>> ruleStack;
+    ruleStack.push_back({cfg->startRule, 0});
+    int rule, c;
+    uint64_t offset;
+    while (!ruleStack.empty()) {
+        std::tie(rule, offset) = ruleStack.back();
+        ruleStack.pop_back();
+        for (uint64_t crossing : crossings[rule]) {
+            occurrences.push_back(offset + crossing);
+        }
+        for (int i = 0; (c = cfg->rules[rule][i]) != CFG::DUMMY_CODE; i++) {
+            if (counts[c] > 0) {
+                if (c < CFG::ALPHABET_SIZE) {
+                    occurrences.push_back(offset);
+                } else {
+                    ruleStack.push_back({c, offset});
+                }
+            }
+            offset += ruleSizes[c];
+        }
+    }
+    std::sort(occurrences.begin(), occurrences.end());
+
+    return occurrences;
+}
+
+}
@@ -0,0 +1,288 @@
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstring>  // strncpy
+#include <stdexcept>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "cfg/query_server.hpp"
+
+namespace cfg {
+
+// construction
+
+QueryServer::QueryServer(CFG* cfg, RandomAccessV2& index, std::string socketPath):
+    cfg(cfg), index(index), socketPath(socketPath)
+{
+    numRequests = 0;
+    numBatches = 0;
+
+    struct sockaddr_un address;
+    if (socketPath.size() >= sizeof(address.sun_path)) {
+        throw std::runtime_error("socket path is too long");
+    }
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, socketPath.c_str(), sizeof(address.sun_path) - 1);
+
+    listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listenFd == -1) {
+        throw std::runtime_error("failed to create socket");
+    }
+    unlink(socketPath.c_str());
+    if (bind(listenFd, (struct sockaddr*) &address, sizeof(address)) == -1 || listen(listenFd, SOMAXCONN) == -1) {
+        ::close(listenFd);
+        throw std::runtime_error("failed to bind " + socketPath);
+    }
+
+    // handle the signals in the event loop so the server can clean up
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    sigprocmask(SIG_BLOCK, &signals, NULL);
+    signalFd = signalfd(-1, &signals, SFD_NONBLOCK | SFD_CLOEXEC);
+
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (signalFd == -1 || epollFd == -1) {
+        ::close(listenFd);
+        unlink(socketPath.c_str());
+        throw std::runtime_error("failed to create event loop");
+    }
+    struct epoll_event event;
+    event.events = EPOLLIN;
+    event.data.fd = listenFd;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, listenFd, &event);
+    event.data.fd = signalFd;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, signalFd, &event);
+}
+
+// destruction
+
+QueryServer::~QueryServer()
+{
+    for (auto& entry : connections) {
+        ::close(entry.first);
+        delete entry.second;
+    }
+    ::close(epollFd);
+    ::close(signalFd);
+    ::close(listenFd);
+    unlink(socketPath.c_str());
+}
+
+// private
+
+void QueryServer::accept()
+{
+    int fd;
+    while ((fd = accept4(listenFd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC)) != -1) {
+        Connection* connection = new Connection();
+        connection->fd = fd;
+        connections[fd] = connection;
+        update(connection);
+    }
+}
+
+bool QueryServer::read(Connection* connection)
+{
+    // drop the requests that have been parsed before reading more
+    std::vector<char>& in = connection->in;
+    in.erase(in.begin(), in.begin() + connection->inPosition);
+    connection->inPosition = 0;
+
+    // the rest is read on a later wakeup since epoll is level-triggered
+    const uint64_t CHUNK_SIZE = 1 << 16;
+    uint64_t size, limit = in.size() + QueryServer::MAX_READ_SIZE;
+    ssize_t n;
+    while (in.size() < limit) {
+        size = in.size();
+        in.resize(size + CHUNK_SIZE);
+        n = ::read(connection->fd, in.data() + size, CHUNK_SIZE);
+        in.resize(size + std::max(n, (ssize_t) 0));
+        if (n > 0) continue;
+        if (n == 0) {
+            connection->peerClosed = true;
+            return true;
+        }
+        if (errno == EINTR) continue;
+        return errno == EAGAIN || errno == EWOULDBLOCK;
+    }
+    return true;
+}
+
+bool QueryServer::write(Connection* connection)
+{
+    std::vector<char>& out = connection->out;
+    ssize_t n;
+    while (connection->outPosition < out.size()) {
+        n = ::send(connection->fd, out.data() + connection->outPosition, out.size() - connection->outPosition, MSG_NOSIGNAL);
+        if (n == -1) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+            return false;
+        }
+        connection->outPosition += n;
+    }
+
+    // keep the unsent responses at the front of the buffer
+    if (connection->outPosition == out.size()) {
+        out.clear();
+        connection->outPosition = 0;
+    } else if (connection->outPosition >= out.size() / 2) {
+        out.erase(out.begin(), out.begin() + connection->outPosition);
+        connection->outPosition = 0;
+    }
+    return true;
+}
+
+void QueryServer::parse(Connection* connection)
+{
+    std::vector<char>& in = connection->in;
+    std::vector<char>& out = connection->out;
+    uint64_t begin, end, length, offset;
+    while (in.size() - connection->inPosition >= QueryServer::REQUEST_SIZE &&
+           out.size() - connection->outPosition < QueryServer::MAX_PENDING_OUTPUT) {
+        begin = getUint64(in.data() + connection->inPosition);
+        end = getUint64(in.data() + connection->inPosition + sizeof(uint64_t));
+        connection->inPosition += QueryServer::REQUEST_SIZE;
+        numRequests++;
+
+        offset = out.size();
+        if (begin == QueryServer::INFO && end == QueryServer::INFO) {
+            out.resize(offset + sizeof(uint64_t));
+            putUint64(out.data() + offset, cfg->textLength);
+        } else if (begin > end || end > cfg->textLength || end - begin > QueryServer::MAX_RESPONSE_LENGTH) {
+            out.resize(offset + sizeof(uint64_t));
+            putUint64(out.data() + offset, QueryServer::ERROR);
+        } else {
+            length = end - begin;
+            out.resize(offset + sizeof(uint64_t) + length);
+            putUint64(out.data() + offset, length);
+            if (length > 0) {
+                jobs.push_back({begin, end, connection, offset + sizeof(uint64_t)});
+            }
+        }
+    }
+}
+
+void QueryServer::execute()
+{
+    if (jobs.empty()) return;
+    numBatches++;
+
+    // neighboring queries descend through the same rules
+    std::sort(jobs.begin(), jobs.end(), [](const Job& a, const Job& b) { return a.begin < b.begin; });
+    for (const Job& job : jobs) {
+        index.get(job.connection->out.data() + job.offset, job.begin, job.end);
+    }
+    jobs.clear();
+}
+
+bool QueryServer::update(Connection* connection)
+{
+    bool pending = connection->outPosition < connection->out.size();
+    if (connection->peerClosed && !pending &&
+        connection->in.size() - connection->inPosition < QueryServer::REQUEST_SIZE) {
+        close(connection);
+        return false;
+    }
+
+    // stop reading while too many responses are waiting so a client can't grow the buffers
+    uint32_t events = 0;
+    if (!connection->peerClosed && connection->out.size() - connection->outPosition < QueryServer::MAX_PENDING_OUTPUT) {
+        events |= EPOLLIN;
+    }
+    if (pending) {
+        events |= EPOLLOUT;
+    }
+    if (events != connection->events) {
+        struct epoll_event event;
+        event.events = events;
+        event.data.fd = connection->fd;
+        int op = (connection->events == 0) ? EPOLL_CTL_ADD : (events == 0) ? EPOLL_CTL_DEL : EPOLL_CTL_MOD;
+        epoll_ctl(epollFd, op, connection->fd, &event);
+        connection->events = events;
+    }
+    return true;
+}
+
+void QueryServer::close(Connection* connection)
+{
+    if (connection->events != 0) {
+        epoll_ctl(epollFd, EPOLL_CTL_DEL, connection->fd, NULL);
+    }
+    ::close(connection->fd);
+    connections.erase(connection->fd);
+    delete connection;
+}
+
+// public
+
+void QueryServer::run()
+{
+    struct epoll_event events[QueryServer::MAX_EVENTS];
+    int n;
+    bool running = true, backlog = false;
+    std::vector<Connection*> failed, open;
+    while (running) {
+        // don't wait if requests that were held back can now be answered
+        n = epoll_wait(epollFd, events, QueryServer::MAX_EVENTS, backlog ? 0 : -1);
+        if (n == -1) {
+            if (errno == EINTR) continue;
+            throw std::runtime_error("failed to wait for events");
+        }
+
+        // read everything that arrived
+        for (int i = 0; i < n; i++) {
+            int fd = events[i].data.fd;
+            if (fd == listenFd) {
+                accept();
+            } else if (fd == signalFd) {
+                running = false;
+            } else {
+                Connection* connection = connections[fd];
+                if ((events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) && !read(connection)) {
+                    failed.push_back(connection);
+                }
+            }
+        }
+        for (Connection* connection : failed) {
+            close(connection);
+        }
+        failed.clear();
+
+        // answer all the connections' complete requests as one batch
+        for (auto& entry : connections) {
+            parse(entry.second);
+        }
+        execute();
+
+        // send what can be sent now and wait for the rest
+        for (auto& entry : connections) {
+            if (!write(entry.second)) {
+                failed.push_back(entry.second);
+            }
+        }
+        for (Connection* connection : failed) {
+            close(connection);
+        }
+        failed.clear();
+        for (auto& entry : connections) {
+            open.push_back(entry.second);
+        }
+        backlog = false;
+        for (Connection* connection : open) {
+            if (update(connection)) {
+                backlog |= connection->in.size() - connection->inPosition >= QueryServer::REQUEST_SIZE &&
+                           connection->out.size() - connection->outPosition < QueryServer::MAX_PENDING_OUTPUT;
+            }
+        }
+        open.clear();
+    }
+}
+
+}
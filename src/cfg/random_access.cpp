@@ -4,9 +4,17 @@
 
 namespace cfg {
 
-// random access
+// writes to a stream one character at a time
+struct StreamOutput
+{
+    std::ostream& out;
+    void put(char c) { out << c; }
+};
 
-void RandomAccess::get(std::ostream& out, uint64_t begin, uint64_t end)
+// private
+
+template <class Output>
+void RandomAccess::decode(Output& out, uint64_t begin, uint64_t end)
 {
     if (begin < 0 || end >= cfg->textLength || begin > end) {
         throw std::runtime_error("begin/end out of bounds");
@@ -33,7 +41,7 @@ void RandomAccess::get(std::ostream& out, uint64_t begin, uint64_t end)
             if (ignore > 0) {
                 ignore--;
             } else {
-                out << (char) cfg->rules[r][i];
+                out.put((char) cfg->rules[r][i]);
             }
             i++;
             j++;
@@ -47,4 +55,17 @@ void RandomAccess::get(std::ostream& out, uint64_t begin, uint64_t end)
     }
 }
 
+// random access
+
+void RandomAccess::get(std::ostream& out, uint64_t begin, uint64_t end)
+{
+    StreamOutput output = {out};
+    decode(output, begin, end);
+}
+
+void RandomAccess::get(io::Sink& out, uint64_t begin, uint64_t end)
+{
+    decode(out, begin, end);
+}
+
 }
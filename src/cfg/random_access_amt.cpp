@@ -1,40 +1,36 @@
+#include <algorithm>
+#include <unistd.h>
 #include "amt/key.hpp"
 #include "amt/set.hpp"
 #include "cfg/random_access_amt.hpp"
 
 namespace cfg {
 
-// static
-
-uint64_t RandomAccessAMT::getKey(uint8_t* key)
-{
-    return (uint64_t) amt::get6Int(key);
-}
-
-void RandomAccessAMT::setKey(uint8_t* key, uint64_t value)
-{
-    amt::set6Int(key, (uint32_t) value);
-}
-
 // construction
 
-RandomAccessAMT::RandomAccessAMT(CFG* cfg): RandomAccess(cfg)
+RandomAccessAMT::RandomAccessAMT(CFG* cfg, std::string filename): RandomAccess(cfg)
 {
-    amt::Set set(1024);
-    setValues(set);
-    cset = new amt::CompressedSumSet(set, 6, RandomAccessAMT::getKey, RandomAccessAMT::setKey);
+    cset6 = NULL;
+    cset11 = NULL;
+    if (cfg->textLength <= amt::Key6::MAX_VALUE) {
+        cset6 = construct<amt::Key6>(filename);
+    } else {
+        cset11 = construct<amt::Key11>(filename);
+    }
 }
 
 // deconstruction
 
 RandomAccessAMT::~RandomAccessAMT()
 {
-    delete cset;
+    delete cset6;
+    delete cset11;
 }
 
 // private
 
-void RandomAccessAMT::setValues(amt::Set& set)
+template <class Key>
+amt::CompressedSumSet<Key>* RandomAccessAMT::construct(std::string filename)
 {
     uint64_t* ruleSizes = new uint64_t[cfg->startRule];
     for (int i = 0; i < CFG::ALPHABET_SIZE; i++) {
@@ -43,18 +39,52 @@ void RandomAccessAMT::setValues(amt::Set& set)
     for (int i = CFG::ALPHABET_SIZE; i < cfg->startRule; i++) {
         ruleSizes[i] = 0;
     }
-    uint8_t* key = new uint8_t[RandomAccessAMT::KEY_LENGTH];
-    int len;
+    uint64_t source = fingerprint(ruleSizes);
+
+    // a saved trie is mapped instead of built, if it was built from this grammar
+    if (!filename.empty() && access(filename.c_str(), F_OK) == 0) {
+        delete[] ruleSizes;
+        return new amt::CompressedSumSet<Key>(filename, source);
+    }
+
+    // the start rule's characters begin at increasing positions so they can be streamed as keys
+    auto keys = [this, ruleSizes]() {
+        return amt::Set::NextKey([this, ruleSizes, pos = (uint64_t) 0, i = 0](uint8_t* key) mutable {
+            if (i == cfg->startSize) return false;
+            Key::set(key, pos);
+            pos += ruleSize(ruleSizes, cfg->rules[cfg->startRule][i++]);
+            return true;
+        });
+    };
+    amt::CompressedSumSet<Key>* cset = new amt::CompressedSumSet<Key>(keys, false, source);
+    delete[] ruleSizes;
+
+    if (!filename.empty()) {
+        try {
+            cset->save(filename);
+        } catch (...) {
+            delete cset;
+            throw;
+        }
+    }
+    return cset;
+}
+
+uint64_t RandomAccessAMT::fingerprint(uint64_t* ruleSizes)
+{
+    // FNV-1a over the text length, the start size and the start rule characters' positions, i.e. the
+    // trie's keys, so a trie of a regenerated grammar or of another grammar type under the same name
+    // isn't used
+    const uint64_t prime = 0x100000001B3;
+    uint64_t hash = 0xCBF29CE484222325;
+    hash = (hash ^ cfg->textLength) * prime;
+    hash = (hash ^ (uint64_t) cfg->startSize) * prime;
     uint64_t pos = 0;
-    int c;
     for (int i = 0; i < cfg->startSize; i++) {
-        c = cfg->rules[cfg->startRule][i];
-        len = amt::set6Int(key, pos);
-        set.set(key, len);
-        pos += ruleSize(ruleSizes, c);
+        hash = (hash ^ pos) * prime;
+        pos += ruleSize(ruleSizes, cfg->rules[cfg->startRule][i]);
     }
-    delete[] ruleSizes;
-    delete[] key;
+    return hash;
 }
 
 uint64_t RandomAccessAMT::ruleSize(uint64_t* ruleSizes, int rule)
@@ -72,14 +102,45 @@ uint64_t RandomAccessAMT::ruleSize(uint64_t* ruleSizes, int rule)
     return ruleSizes[rule];
 }
 
+template <class Key>
+void RandomAccessAMT::rankSelect(amt::CompressedSumSet<Key>* cset, uint64_t i, int& rank, uint64_t& select)
+{
+    uint8_t key[Key::LENGTH];
+    Key::set(key, i);
+    rank = (int) cset->predecessor(key);
+    select = Key::get(key);
+    // the rank is exclusive [0, i) and we want inclusive [0, i]
+    rank += (select == i);
+}
+
 void RandomAccessAMT::rankSelect(uint64_t i, int& rank, uint64_t& select)
 {
-    uint8_t* key = new uint8_t[KEY_LENGTH];
-    // i+1 because rank is exclusive [0, i) and we want inclusive [0, i]
-    amt::set6Int(key, (uint32_t) i + 1);
-    rank = (int) cset->predecessor(key, KEY_LENGTH);
-    select = (uint64_t) amt::get6Int(key);
-    delete[] key;
+    if (cset6 != NULL) {
+        rankSelect(cset6, i, rank, select);
+    } else {
+        rankSelect(cset11, i, rank, select);
+    }
+}
+
+// public
+
+uint64_t RandomAccessAMT::memSize()
+{
+    return (cset6 != NULL) ? cset6->memSize() : cset11->memSize();
+}
+
+void RandomAccessAMT::rankSelectBatch(const uint64_t* positions, uint64_t* ranks, uint64_t* selects, uint64_t n)
+{
+    std::copy(positions, positions + n, selects);
+    if (cset6 != NULL) {
+        cset6->predecessors(selects, ranks, n);
+    } else {
+        cset11->predecessors(selects, ranks, n);
+    }
+    // the ranks are exclusive [0, i) and we want inclusive [0, i]
+    for (uint64_t j = 0; j < n; j++) {
+        ranks[j] += (selects[j] == positions[j]);
+    }
 }
 
 }
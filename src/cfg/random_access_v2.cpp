@@ -4,10 +4,17 @@
 
 namespace cfg {
 
-// random access
+// writes to a caller's array without bounds checks
+struct ArrayOutput
+{
+    char* out;
+    void put(char c) { *out++ = c; }
+};
 
-//void RandomAccessV2::get(std::ostream& out, uint64_t begin, uint64_t end)
-void RandomAccessV2::get(char* out, uint64_t begin, uint64_t end)
+// private
+
+template <class Output>
+void RandomAccessV2::decode(Output& out, uint64_t begin, uint64_t end)
 {
     //if (begin < 0 || end >= cfg->textLength || begin > end) {
     //    throw std::runtime_error("begin/end out of bounds");
@@ -55,8 +62,7 @@ void RandomAccessV2::get(char* out, uint64_t begin, uint64_t end)
             indexStack.pop();
         // terminal character 
         } else if (cfg->rules[r][i] < CFG::ALPHABET_SIZE) {
-            //out << (char) cfg->rules[r][i];
-            out[j] = (char) cfg->rules[r][i];
+            out.put((char) cfg->rules[r][i]);
             i++;
             j++;
         // non-terminal character
@@ -69,4 +75,18 @@ void RandomAccessV2::get(char* out, uint64_t begin, uint64_t end)
     }
 }
 
+// random access
+
+//void RandomAccessV2::get(std::ostream& out, uint64_t begin, uint64_t end)
+void RandomAccessV2::get(char* out, uint64_t begin, uint64_t end)
+{
+    ArrayOutput output = {out};
+    decode(output, begin, end);
+}
+
+void RandomAccessV2::get(io::Sink& out, uint64_t begin, uint64_t end)
+{
+    decode(out, begin, end);
+}
+
 }
@@ -0,0 +1,165 @@
+#include <stdexcept>
+#include "cfg/random_access_v2_il.hpp"
+
+namespace cfg {
+
+// construction
+
+RandomAccessV2IL::RandomAccessV2IL(CFG* cfg): cfg(cfg)
+{
+    initializeRecords();
+    recordStack.reserve(cfg->depth + 1);
+}
+
+// destruction
+
+RandomAccessV2IL::~RandomAccessV2IL()
+{
+    delete startIndex;
+    delete[] records;
+}
+
+// private
+
+void RandomAccessV2IL::initializeRecords()
+{
+    uint64_t* ruleSizes = cfg->expansionSizes();
+
+    // compute where each rule's records begin; +1 for the end of rule record
+    uint64_t* ruleOffsets = new uint64_t[cfg->startRule + 1];
+    numRecords = 0;
+    int j;
+    for (int i = CFG::ALPHABET_SIZE; i <= cfg->startRule; i++) {
+        ruleOffsets[i] = numRecords;
+        for (j = 0; cfg->rules[i][j] != CFG::DUMMY_CODE; j++);
+        numRecords += j + 1;
+    }
+    if (numRecords + CFG::ALPHABET_SIZE >= RandomAccessV2IL::END_OF_RULE) {
+        delete[] ruleSizes;
+        delete[] ruleOffsets;
+        throw std::runtime_error("too many symbols for 32 bit record references");
+    }
+    startRecord = (uint32_t) ruleOffsets[cfg->startRule];
+
+    // index the start positions
+    uint64_t* startPositions = new uint64_t[cfg->startSize];
+    uint64_t pos = 0;
+    int c;
+    for (int i = 0; i < cfg->startSize; i++) {
+        c = cfg->rules[cfg->startRule][i];
+        startPositions[i] = pos;
+        pos += ruleSizes[c];
+    }
+    startIndex = new StartIndexSD(startPositions, cfg->startSize, cfg->textLength);
+    delete[] startPositions;
+
+    // rules are ordered by expansion length so the rules that are too large for a record are last
+    int firstLargeRule = cfg->startRule;
+    while (firstLargeRule > CFG::ALPHABET_SIZE && ruleSizes[firstLargeRule - 1] >= RandomAccessV2IL::LARGE_EXPANSION) {
+        firstLargeRule--;
+    }
+    largeExpansions.assign(ruleSizes + firstLargeRule, ruleSizes + cfg->startRule);
+
+    // interleave the rules with the expansion lengths of their characters
+    records = new uint64_t[numRecords];
+    uint64_t idx = 0, size;
+    uint32_t ref;
+    for (int i = CFG::ALPHABET_SIZE; i <= cfg->startRule; i++) {
+        for (j = 0; (c = cfg->rules[i][j]) != CFG::DUMMY_CODE; j++) {
+            if (c < CFG::ALPHABET_SIZE) {
+                ref = (uint32_t) c;
+            } else {
+                ref = (uint32_t) (ruleOffsets[c] + CFG::ALPHABET_SIZE);
+            }
+            size = ruleSizes[c];
+            if (size >= RandomAccessV2IL::LARGE_EXPANSION) {
+                size = RandomAccessV2IL::LARGE_EXPANSION + (c - firstLargeRule);
+            }
+            records[idx++] = (size << 32) | ref;
+        }
+        records[idx++] = RandomAccessV2IL::END_OF_RULE;
+    }
+
+    // clean up
+    delete[] ruleSizes;
+    delete[] ruleOffsets;
+}
+
+inline uint64_t RandomAccessV2IL::recordSize(uint64_t record)
+{
+    uint64_t size = record >> 32;
+    if (size >= RandomAccessV2IL::LARGE_EXPANSION) {
+        return largeExpansions[size - RandomAccessV2IL::LARGE_EXPANSION];
+    }
+    return size;
+}
+
+// public
+
+uint64_t RandomAccessV2IL::memSize()
+{
+    uint64_t recordsSize = sizeof(uint64_t) * numRecords;
+    uint64_t largeExpansionsSize = sizeof(uint64_t) * largeExpansions.capacity();
+
+    uint64_t startIndexSize = startIndex->memSize();
+
+    return recordsSize + largeExpansionsSize + startIndexSize;
+}
+
+// random access
+
+void RandomAccessV2IL::get(char* out, uint64_t begin, uint64_t end)
+{
+    uint64_t length = end - begin;
+    recordStack.clear();
+
+    // get the start rule record to start parsing at
+    int rank;
+    uint64_t selected;
+    startIndex->predecessor(begin, rank, selected);
+    uint32_t p = startRecord + rank - 1;
+
+    // descend the parse tree to the correct start position
+    uint64_t record, size, ignore = begin - selected;
+    uint32_t ref;
+    while (ignore > 0) {
+        record = records[p];
+        ref = (uint32_t) record;
+        // terminal character
+        if (ref < CFG::ALPHABET_SIZE) {
+            p++;
+            ignore--;
+        // non-terminal character
+        } else {
+            size = recordSize(record);
+            if (size > ignore) {
+                recordStack.push_back(p + 1);
+                p = ref - CFG::ALPHABET_SIZE;
+            } else {
+                ignore -= size;
+                p++;
+            }
+        }
+    }
+
+    // decode the substring
+    for (uint64_t j = 0; j < length;) {
+        ref = (uint32_t) records[p];
+        // end of rule
+        if (ref == RandomAccessV2IL::END_OF_RULE) {
+            p = recordStack.back();
+            recordStack.pop_back();
+        // terminal character
+        } else if (ref < CFG::ALPHABET_SIZE) {
+            out[j] = (char) ref;
+            p++;
+            j++;
+        // non-terminal character
+        } else {
+            recordStack.push_back(p + 1);
+            p = ref - CFG::ALPHABET_SIZE;
+        }
+    }
+}
+
+}
@@ -0,0 +1,167 @@
+#include <bit>
+#include <sdsl/util.hpp>
+#include "cfg/rules_codec.hpp"
+
+namespace cfg {
+
+// helpers
+
+/**
+ * Computes the offset of every rule in the concatenated rules. If the rules other than the start
+ * rule all have the same length then ruleStride is set and offsets is left empty.
+ *
+ * @return The total number of characters, including end of rule characters.
+ */
+static uint64_t computeOffsets(CFG* cfg, sdsl::int_vector<>& offsets, uint64_t& ruleStride, uint64_t& startOffset)
+{
+    // check if every rule has the same length
+    int j, length = -1;
+    ruleStride = 0;
+    for (int i = CFG::ALPHABET_SIZE; i < cfg->startRule; i++) {
+        for (j = 0; cfg->rules[i][j] != CFG::DUMMY_CODE; j++);
+        if (length == -1) {
+            length = j;
+        } else if (length != j) {
+            length = -1;
+            break;
+        }
+    }
+    startOffset = cfg->rulesSize + cfg->numRules;
+    if (length != -1) {
+        ruleStride = length + 1;
+        return startOffset + cfg->startSize + 1;
+    }
+
+    // otherwise store the offsets
+    offsets = sdsl::int_vector<>(cfg->numRules, 0, 64 - std::countl_zero(startOffset | 1));
+    uint64_t offset = 0;
+    for (int i = CFG::ALPHABET_SIZE; i < cfg->startRule; i++) {
+        offsets[i - CFG::ALPHABET_SIZE] = offset;
+        for (j = 0; cfg->rules[i][j] != CFG::DUMMY_CODE; j++);
+        offset += j + 1;
+    }
+    return startOffset + cfg->startSize + 1;
+}
+
+// bit-packed
+
+RulesPacked::RulesPacked(CFG* cfg)
+{
+    uint64_t size = computeOffsets(cfg, offsets, ruleStride, startOffset);
+    endOfRule = cfg->startRule;
+    width = 64 - std::countl_zero(endOfRule);
+    characters = sdsl::int_vector<>(size, 0, width);
+
+    uint64_t idx = 0;
+    int c;
+    for (int i = CFG::ALPHABET_SIZE; i <= cfg->startRule; i++) {
+        for (int j = 0; (c = cfg->rules[i][j]) != CFG::DUMMY_CODE; j++) {
+            characters[idx++] = c;
+        }
+        characters[idx++] = endOfRule;
+    }
+}
+
+uint64_t RulesPacked::memSize()
+{
+    return sdsl::size_in_bytes(characters) + sdsl::size_in_bytes(offsets);
+}
+
+// StreamVByte
+
+uint8_t RulesVByte::groupLengths[256];
+#ifdef __SSSE3__
+uint8_t RulesVByte::shuffles[256][16];
+#endif
+std::once_flag RulesVByte::tablesInitialized;
+
+static int byteLength(uint32_t value)
+{
+    return (value < (1 << 8)) ? 1 : (value < (1 << 16)) ? 2 : (value < (1 << 24)) ? 3 : 4;
+}
+
+void RulesVByte::initializeTables()
+{
+    for (int key = 0; key < 256; key++) {
+        int offset = 0;
+        for (int lane = 0; lane < 4; lane++) {
+            int length = ((key >> (2 * lane)) & 0x3) + 1;
+#ifdef __SSSE3__
+            for (int b = 0; b < 4; b++) {
+                // 0x80 zeroes the byte
+                shuffles[key][4 * lane + b] = (b < length) ? offset + b : 0x80;
+            }
+#endif
+            offset += length;
+        }
+        groupLengths[key] = offset;
+    }
+}
+
+RulesVByte::RulesVByte(CFG* cfg)
+{
+    std::call_once(tablesInitialized, initializeTables);
+    uint64_t size = computeOffsets(cfg, offsets, ruleStride, startOffset);
+    endOfRule = cfg->startRule;
+
+    // +1 group so next() can always decode the group after the cursor
+    numGroups = (size + 3) / 4 + 1;
+    control = new uint8_t[numGroups]();
+    uint64_t numBlocks = (numGroups + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    blockOffsets = sdsl::int_vector<>(numBlocks, 0, 64);
+
+    // compute the control bytes and the data offset samples
+    uint64_t idx = 0, offset = 0;
+    uint32_t value;
+    int c, length;
+    for (int i = CFG::ALPHABET_SIZE; i <= cfg->startRule; i++) {
+        for (int j = 0; ; j++) {
+            c = cfg->rules[i][j];
+            value = (c == CFG::DUMMY_CODE) ? endOfRule : (uint32_t) c;
+            if (idx % (4 * BLOCK_SIZE) == 0) {
+                blockOffsets[idx / (4 * BLOCK_SIZE)] = offset;
+            }
+            length = byteLength(value);
+            control[idx >> 2] |= (length - 1) << (2 * (idx & 0x3));
+            offset += length;
+            idx++;
+            if (c == CFG::DUMMY_CODE) break;
+        }
+    }
+    // the padding groups encode 1 byte zeros
+    for (; idx < 4 * numGroups; idx++) {
+        if (idx % (4 * BLOCK_SIZE) == 0) {
+            blockOffsets[idx / (4 * BLOCK_SIZE)] = offset;
+        }
+        offset++;
+    }
+    dataSize = offset;
+    sdsl::util::bit_compress(blockOffsets);
+
+    // write the data; +16 so any group can be loaded with a single 16 byte load
+    data = new uint8_t[dataSize + 16]();
+    offset = 0;
+    for (int i = CFG::ALPHABET_SIZE; i <= cfg->startRule; i++) {
+        for (int j = 0; ; j++) {
+            c = cfg->rules[i][j];
+            value = (c == CFG::DUMMY_CODE) ? endOfRule : (uint32_t) c;
+            length = byteLength(value);
+            std::memcpy(data + offset, &value, length);  // little endian
+            offset += length;
+            if (c == CFG::DUMMY_CODE) break;
+        }
+    }
+}
+
+RulesVByte::~RulesVByte()
+{
+    delete[] control;
+    delete[] data;
+}
+
+uint64_t RulesVByte::memSize()
+{
+    return numGroups + dataSize + sdsl::size_in_bytes(blockOffsets) + sdsl::size_in_bytes(offsets);
+}
+
+}
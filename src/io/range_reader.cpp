@@ -0,0 +1,85 @@
+#include <cerrno>
+#include <stdexcept>
+#include <string>
+#include <unistd.h>
+#include "io/range_reader.hpp"
+
+namespace io {
+
+// construction
+
+RangeReader::RangeReader(int fd, uint64_t bufferSize): fd(fd), bufferSize(bufferSize)
+{
+    buffer = new char[bufferSize];
+    cursor = limit = buffer;
+    eof = false;
+    numRanges = 0;
+}
+
+// destruction
+
+RangeReader::~RangeReader()
+{
+    delete[] buffer;
+}
+
+// private
+
+bool RangeReader::fill()
+{
+    if (cursor < limit) return true;
+    while (!eof) {
+        ssize_t n = read(fd, buffer, bufferSize);
+        if (n == -1) {
+            if (errno == EINTR) continue;
+            throw std::runtime_error("failed to read ranges");
+        }
+        eof = n == 0;
+        cursor = buffer;
+        limit = buffer + n;
+        if (n > 0) return true;
+    }
+    return false;
+}
+
+bool RangeReader::parse(uint64_t& value)
+{
+    // skip whitespace
+    while (fill() && (*cursor == ' ' || *cursor == '\n' || *cursor == '\t' || *cursor == '\r')) {
+        cursor++;
+    }
+    if (!fill()) return false;
+
+    // integers may span blocks so parse a character at a time
+    if (*cursor < '0' || *cursor > '9') {
+        throw std::runtime_error("range " + std::to_string(numRanges + 1) + " isn't a pair of unsigned integers");
+    }
+    value = 0;
+    uint64_t digit;
+    while (fill() && *cursor >= '0' && *cursor <= '9') {
+        digit = *cursor - '0';
+        if (value > (UINT64_MAX - digit) / 10) {
+            throw std::runtime_error("range " + std::to_string(numRanges + 1) + " is too large");
+        }
+        value = value * 10 + digit;
+        cursor++;
+    }
+    if (fill() && *cursor != ' ' && *cursor != '\n' && *cursor != '\t' && *cursor != '\r') {
+        throw std::runtime_error("range " + std::to_string(numRanges + 1) + " isn't a pair of unsigned integers");
+    }
+    return true;
+}
+
+// public
+
+bool RangeReader::next(uint64_t& begin, uint64_t& end)
+{
+    if (!parse(begin)) return false;
+    if (!parse(end)) {
+        throw std::runtime_error("range " + std::to_string(numRanges + 1) + " is missing its end");
+    }
+    numRanges++;
+    return true;
+}
+
+}
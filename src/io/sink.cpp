@@ -0,0 +1,245 @@
+#include <algorithm>
+#include <cerrno>
+#include <climits>  // IOV_MAX
+#include <cstring>  // memcpy
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "io/sink.hpp"
+
+namespace io {
+
+// writes a whole block, retrying partial and interrupted writes
+static void writeAll(int fd, const char* data, uint64_t length)
+{
+    ssize_t written;
+    while (length > 0) {
+        written = ::write(fd, data, length);
+        if (written == -1) {
+            if (errno == EINTR) continue;
+            throw std::runtime_error("failed to write output");
+        }
+        data += written;
+        length -= written;
+    }
+}
+
+// Sink
+
+void Sink::write(const char* data, uint64_t length)
+{
+    uint64_t take;
+    while (length > 0) {
+        if (cursor == limit) overflow();
+        take = std::min(length, (uint64_t) (limit - cursor));
+        std::memcpy(cursor, data, take);
+        cursor += take;
+        data += take;
+        length -= take;
+    }
+}
+
+// BufferSink
+
+BufferSink::BufferSink(char* buffer, uint64_t capacity): buffer(buffer)
+{
+    cursor = buffer;
+    limit = buffer + capacity;
+}
+
+void BufferSink::overflow()
+{
+    throw std::runtime_error("buffer sink is full");
+}
+
+// FdSink
+
+FdSink::FdSink(int fd, uint64_t bufferSize): fd(fd), bufferSize(bufferSize)
+{
+    buffer = new char[bufferSize];
+    cursor = buffer;
+    limit = buffer + bufferSize;
+}
+
+FdSink::~FdSink()
+{
+    // errors can't be thrown from here so flush explicitly to see them
+    try {
+        flush();
+    } catch (const std::runtime_error&) { }
+    delete[] buffer;
+}
+
+void FdSink::overflow()
+{
+    flush();
+}
+
+void FdSink::write(const char* data, uint64_t length)
+{
+    if (length < bufferSize) {
+        Sink::write(data, length);
+        return;
+    }
+    flush();
+    writeAll(fd, data, length);
+}
+
+void FdSink::flush()
+{
+    writeAll(fd, buffer, cursor - buffer);
+    cursor = buffer;
+}
+
+// WritevSink
+
+WritevSink::WritevSink(int fd, uint64_t chunkSize, int maxChunks):
+    fd(fd), chunkSize(chunkSize), maxChunks(maxChunks)
+{
+    for (int i = 0; i < maxChunks; i++) {
+        chunks.push_back(new char[chunkSize]);
+    }
+    numChunks = 1;
+    chunkBegin = cursor = chunks[0];
+    limit = chunks[0] + chunkSize;
+}
+
+WritevSink::~WritevSink()
+{
+    try {
+        flush();
+    } catch (const std::runtime_error&) { }
+    for (char* chunk : chunks) {
+        delete[] chunk;
+    }
+}
+
+void WritevSink::endChunk()
+{
+    if (cursor > chunkBegin) {
+        iovecs.push_back({chunkBegin, (size_t) (cursor - chunkBegin)});
+    }
+    chunkBegin = cursor;
+}
+
+void WritevSink::overflow()
+{
+    endChunk();
+    if (numChunks == maxChunks) {
+        flush();
+        return;
+    }
+    chunkBegin = cursor = chunks[numChunks++];
+    limit = cursor + chunkSize;
+}
+
+void WritevSink::write(const char* data, uint64_t length)
+{
+    if (length < chunkSize) {
+        Sink::write(data, length);
+        return;
+    }
+    endChunk();
+    iovecs.push_back({(void*) data, (size_t) length});
+    if ((int) iovecs.size() >= 2 * maxChunks) {
+        flush();
+    }
+}
+
+void WritevSink::flush()
+{
+    endChunk();
+
+    // writev can write part of the vectors so continue from where it stopped
+    uint64_t first = 0;
+    int count;
+    ssize_t written;
+    while (first < iovecs.size()) {
+        count = (int) std::min(iovecs.size() - first, (uint64_t) IOV_MAX);
+        written = writev(fd, iovecs.data() + first, count);
+        if (written == -1) {
+            if (errno == EINTR) continue;
+            throw std::runtime_error("failed to write output");
+        }
+        while (first < iovecs.size() && (uint64_t) written >= iovecs[first].iov_len) {
+            written -= iovecs[first].iov_len;
+            first++;
+        }
+        if (written > 0) {
+            iovecs[first].iov_base = (char*) iovecs[first].iov_base + written;
+            iovecs[first].iov_len -= written;
+        }
+    }
+    iovecs.clear();
+
+    numChunks = 1;
+    chunkBegin = cursor = chunks[0];
+    limit = chunks[0] + chunkSize;
+}
+
+// VmspliceSink
+
+VmspliceSink::VmspliceSink(int fd, uint64_t bufferSize): fd(fd)
+{
+    // the pipe may round its size up so use whatever it was set to
+    int pipeSize = fcntl(fd, F_SETPIPE_SZ, (int) bufferSize);
+    if (pipeSize == -1) {
+        throw std::runtime_error("vmsplice sink requires a pipe");
+    }
+    this->bufferSize = pipeSize;
+
+    // the pipe holds references to the pages so they're mapped rather than allocated and never
+    // handed to another allocation while the reader may still see them
+    buffers[0] = buffers[1] = nullptr;
+    for (int i = 0; i < 2; i++) {
+        void* mapped = mmap(NULL, this->bufferSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (mapped == MAP_FAILED) {
+            if (buffers[0] != nullptr) munmap(buffers[0], this->bufferSize);
+            throw std::runtime_error("failed to allocate vmsplice buffers");
+        }
+        buffers[i] = (char*) mapped;
+    }
+    current = 0;
+    flushed = cursor = buffers[0];
+    limit = buffers[0] + this->bufferSize;
+}
+
+VmspliceSink::~VmspliceSink()
+{
+    try {
+        flush();
+    } catch (const std::runtime_error&) { }
+    munmap(buffers[0], bufferSize);
+    munmap(buffers[1], bufferSize);
+}
+
+void VmspliceSink::overflow()
+{
+    flush();
+
+    // once all of a full buffer's pages are in the pipe it holds nothing of the other buffer, even
+    // if the buffer was spliced in parts, so the other buffer can be reused
+    current = 1 - current;
+    flushed = cursor = buffers[current];
+    limit = buffers[current] + bufferSize;
+}
+
+void VmspliceSink::flush()
+{
+    // the spliced pages must not change so later characters go after them in the same buffer
+    struct iovec iov = {flushed, (size_t) (cursor - flushed)};
+    ssize_t spliced;
+    while (iov.iov_len > 0) {
+        spliced = vmsplice(fd, &iov, 1, 0);
+        if (spliced == -1) {
+            if (errno == EINTR) continue;
+            throw std::runtime_error("failed to splice output");
+        }
+        iov.iov_base = (char*) iov.iov_base + spliced;
+        iov.iov_len -= spliced;
+    }
+    flushed = cursor;
+}
+
+}
@@ -1,19 +1,33 @@
 #include <iostream>
 #include <chrono>
+#include <fcntl.h>
+#include <unistd.h>
 #include <vector>
 
+#include "bench/bench.hpp"
+#include "cfg/batch_extractor.hpp"
 #include "cfg/cfg.hpp"
-//#include "cfg/random_access_amt.hpp"
+#include "cfg/query_server.hpp"
+#include "cfg/random_access_amt.hpp"
 //#include "cfg/random_access_bv.hpp"
 //#include "cfg/random_access_v2_bv.hpp"
+#include "cfg/random_access_v2_cache.hpp"
+#include "cfg/random_access_v2_coded.hpp"
+#include "cfg/random_access_v2_il.hpp"
 #include "cfg/random_access_v2_sd.hpp"
+#include "cfg/start_index_eytzinger.hpp"
+#include "cfg/start_index_pgm.hpp"
+#include "io/sink.hpp"
 #include "xoroshiro/xoroshiro128plus.hpp"
 
 using namespace std;
 using namespace cfg;
 
 void usage(int argc, char* argv[]) {
-    cerr << "usage: " << argv[0] << " <type> <filename> <querysize> [numqueries=10000] [seed=random_device]" << endl;
+    cerr << "usage: " << argv[0] << " <type> <filename> <querysize> [numqueries=10000] [seed=random_device] [index=sd]" << endl;
+    cerr << "       " << argv[0] << " extract <type> <filename> [ranges=-] [output=-]" << endl;
+    cerr << "       " << argv[0] << " serve <type> <filename> <socket>" << endl;
+    cerr << "       " << argv[0] << " client <socket> <querysize> [numqueries=100000] [connections=4] [depth=16] [seed=random_device]" << endl;
     cerr << endl;
     cerr << "args: " << endl;
     cerr << "\ttype={mrrepair|navarro|bigrepair}: the type of grammar to load" << endl;
@@ -24,6 +38,32 @@ void usage(int argc, char* argv[]) {
     cerr << "\tquerysize: the size of the substring to query for when benchmarking" << endl;
     cerr << "\tnumqueries: the number of queries to run when benchmarking" << endl;
     cerr << "\tseed: the seed to use with the pseudo-random number generator" << endl;
+    cerr << "\tindex={sd|ey|pgm|il|packed|vbyte|cache|amt|start|startsweep|pattern|kr|counts|lines|grep|extract|sinks|amtinsert|amtpredecessor|amtrange}: the random access index to benchmark" << endl;
+    cerr << "\t\tsd: rules with sd_vector encoded expansion lengths" << endl;
+    cerr << "\t\tey: sd with an Eytzinger layout start rule index" << endl;
+    cerr << "\t\tpgm: sd with a learned (piecewise linear) start rule index" << endl;
+    cerr << "\t\til: rule records interleaved with expansion lengths" << endl;
+    cerr << "\t\tpacked: sd with bit-packed rules" << endl;
+    cerr << "\t\tvbyte: sd with StreamVByte encoded rules" << endl;
+    cerr << "\t\tcache: sd with the first and last querysize characters of each rule cached" << endl;
+    cerr << "\t\tamt: rules with an AMT start rule index that is saved to filename.amt and mapped from it on later runs" << endl;
+    cerr << "\t\tstart: microbenchmarks the start rule lookups, including batched AMT lookups, instead of full queries" << endl;
+    cerr << "\t\tstartsweep: microbenchmarks the start rule lookups over increasing start sizes" << endl;
+    cerr << "\t\tpattern: counts and locates patterns of length querysize on the grammar instead of random access" << endl;
+    cerr << "\t\tkr: compares substrings of length querysize with Karp-Rabin fingerprints instead of extracting them" << endl;
+    cerr << "\t\tcounts: counts the most frequent bytes in ranges of length querysize with per-rule counts" << endl;
+    cerr << "\t\tlines: selects and gets newline-delimited lines with per-rule newline counts" << endl;
+    cerr << "\t\tgrep: runs the DFAs of patterns of length querysize over the grammar with memoized rule transitions" << endl;
+    cerr << "\t\textract: decompresses the whole text on increasing numbers of threads" << endl;
+    cerr << "\t\tsinks: writes the whole text through buffer, fd, writev and vmsplice output sinks" << endl;
+    cerr << "\t\tamtinsert: inserts numqueries random keys into AMT sets and maps, and bulk loads them into a set, and reports throughput and memory" << endl;
+    cerr << "\t\tamtpredecessor: times predecessor queries on compressed and level order AMT sets and an sd_vector of numqueries random keys and reports memory" << endl;
+    cerr << "\t\tamtrange: scans ranges of an AMT map and set of numqueries random keys with lazy ranges and with the map's visitor" << endl;
+    cerr << "\tranges: a file of \"begin end\" pairs to extract the substrings [begin, end) of, or - for stdin" << endl;
+    cerr << "\toutput: the file to write the substrings to as records of an 8 byte little-endian length and the substring, or - for stdout" << endl;
+    cerr << "\tsocket: the Unix domain socket the server listens on" << endl;
+    cerr << "\tconnections: the number of client connections, each on its own thread" << endl;
+    cerr << "\tdepth: the number of queries each client connection keeps in flight" << endl;
 }
 
 CFG* loadGrammar(string type, string filename) {
@@ -39,9 +79,192 @@ CFG* loadGrammar(string type, string filename) {
     return NULL;
 }
 
+/**
+ * Runs random access queries against an index and returns the median of the average query times.
+ */
+template <class Index>
+double benchmark(Index& index, CFG* cfg, xoroshiro::xoroshiro128plus_engine& eng, uint32_t querySize, uint32_t numQueries)
+{
+    std::uniform_real_distribution<> dist(0.0, 1.0);
+    chrono::steady_clock::time_point startTime, endTime;
+    uint32_t numLoops = 11;
+
+    uint64_t begin, end;
+    char* out = new char[querySize];
+    std::vector<double> times(numLoops);
+
+    for (int i = 0; i < numLoops; i++) {
+      double duration = 0;
+      for (int j = 0; j < numQueries; j++) {
+          begin = (cfg->getTextLength() - querySize) * dist(eng);
+          end = begin + querySize - 1;
+
+          startTime = chrono::steady_clock::now();
+          index.get(out, begin, end);
+          endTime = chrono::steady_clock::now();
+          duration += chrono::duration_cast<chrono::microseconds>(endTime - startTime).count();
+      }
+
+      times[i] = duration / numQueries;
+    }
+    std::sort(times.begin(), times.end());
+
+    delete[] out;
+
+    return times[numLoops / 2];
+}
+
+/**
+ * Adapts an index that writes substrings to sinks to the char arrays of the benchmark.
+ */
+template <class Index>
+class BufferedIndex
+{
+    Index& index;
+
+public:
+
+    BufferedIndex(Index& index): index(index) { }
+
+    void get(char* out, uint64_t begin, uint64_t end)
+    {
+        io::BufferSink sink(out, end - begin + 1);
+        index.get(sink, begin, end);
+    }
+};
+
+/**
+ * Extracts the substrings of ranges read from a file or stdin and writes them as records to a file
+ * or stdout.
+ */
+int extract(int argc, char* argv[])
+{
+    if (argc < 4) {
+      usage(argc, argv);
+      return 1;
+    }
+    string rangesFilename = (argc >= 5) ? argv[4] : "-";
+    string outputFilename = (argc >= 6) ? argv[5] : "-";
+
+    CFG* cfg = loadGrammar(argv[2], argv[3]);
+    if (cfg == NULL) {
+      usage(argc, argv);
+      return 1;
+    }
+
+    int inFd = STDIN_FILENO, outFd = STDOUT_FILENO;
+    if (rangesFilename != "-" && (inFd = open(rangesFilename.c_str(), O_RDONLY)) == -1) {
+      cerr << "failed to open " << rangesFilename << endl;
+      delete cfg;
+      return 1;
+    }
+    if (outputFilename != "-" && (outFd = open(outputFilename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644)) == -1) {
+      cerr << "failed to open " << outputFilename << endl;
+      delete cfg;
+      return 1;
+    }
+
+    int status = 0;
+    {
+      RandomAccessV2SD<> sd(cfg);
+      BatchExtractor extractor(cfg, sd);
+      chrono::steady_clock::time_point startTime = chrono::steady_clock::now();
+      try {
+        uint64_t numRecords = extractor.run(inFd, outFd);
+        chrono::steady_clock::time_point endTime = chrono::steady_clock::now();
+        double seconds = chrono::duration_cast<chrono::microseconds>(endTime - startTime).count() / 1e6;
+        cerr << "extracted " << numRecords << " ranges in " << seconds << "[s]" << endl;
+      } catch (const std::runtime_error& e) {
+        cerr << e.what() << endl;
+        status = 1;
+      }
+    }
+
+    if (inFd != STDIN_FILENO) close(inFd);
+    if (outFd != STDOUT_FILENO) close(outFd);
+    delete cfg;
+
+    return status;
+}
+
+/**
+ * Serves random access queries over a Unix domain socket until interrupted.
+ */
+int serve(int argc, char* argv[])
+{
+    if (argc < 5) {
+      usage(argc, argv);
+      return 1;
+    }
+
+    CFG* cfg = loadGrammar(argv[2], argv[3]);
+    if (cfg == NULL) {
+      usage(argc, argv);
+      return 1;
+    }
+
+    int status = 0;
+    {
+      RandomAccessV2SD<> sd(cfg);
+      try {
+        QueryServer server(cfg, sd, argv[4]);
+        cerr << "serving " << argv[3] << " on " << argv[4] << endl;
+        server.run();
+        cerr << "served " << server.getNumRequests() << " requests in " << server.getNumBatches() << " batches" << endl;
+      } catch (const std::runtime_error& e) {
+        cerr << e.what() << endl;
+        status = 1;
+      }
+    }
+    delete cfg;
+
+    return status;
+}
+
+/**
+ * Generates random access load on a server and reports its throughput and latency.
+ */
+int client(int argc, char* argv[])
+{
+    if (argc < 4) {
+      usage(argc, argv);
+      return 1;
+    }
+    uint32_t querySize = std::stoi(argv[3]);
+    uint32_t numQueries = (argc >= 5) ? std::stoi(argv[4]) : 100000;
+    uint32_t numConnections = (argc >= 6) ? std::stoi(argv[5]) : 4;
+    uint32_t depth = (argc >= 7) ? std::stoi(argv[6]) : 16;
+
+    xoroshiro::xoroshiro128plus_engine eng;
+    if (argc >= 8) {
+      eng.seed([&argv]() { return std::stoi(argv[7]); });
+    } else {
+      std::random_device dev{};
+      eng.seed([&dev]() { return dev(); });
+    }
+
+    try {
+      bench::client(argv[2], eng, querySize, numQueries, numConnections, depth);
+    } catch (const std::runtime_error& e) {
+      cerr << e.what() << endl;
+      return 1;
+    }
+    return 0;
+}
+
 int main(int argc, char* argv[])
 {
 
+    if (argc >= 2 && string(argv[1]) == "extract") {
+      return extract(argc, argv);
+    }
+    if (argc >= 2 && string(argv[1]) == "serve") {
+      return serve(argc, argv);
+    }
+    if (argc >= 2 && string(argv[1]) == "client") {
+      return client(argc, argv);
+    }
+
     // check the command-line arguments
     if (argc < 4) {
       usage(argc, argv);
@@ -63,7 +286,6 @@ int main(int argc, char* argv[])
       std::random_device dev{};
       eng.seed([&dev]() { return dev(); });
     }
-    std::uniform_real_distribution<> dist(0.0, 1.0);
 
     // load the grammar
     string type = argv[1];
@@ -80,85 +302,112 @@ int main(int argc, char* argv[])
     uint64_t cfgMemSize = cfg->memSize();
     cerr << "mem size: " << cfgMemSize << endl;
 
-    // instantiate indexes
-    //RandomAccessAMT amt(cfg);
-    //RandomAccessBV<sdsl::bit_vector, sdsl::rank_support_v5<>, sdsl::select_support_mcl<>> bv(cfg);
-    //RandomAccessV2BV<sdsl::bit_vector, sdsl::rank_support_v5<>, sdsl::select_support_mcl<>> bv2(cfg);
-    RandomAccessV2SD sd(cfg);
-    uint64_t sdMemSize = sd.memSize();
-    cerr << "sdv2 mem size: " << sdMemSize << endl;
+    // benchmark the index
+    string index = "sd";
+    if (argc >= 7) {
+      index = argv[6];
+    }
+    if (index == "sd") {
+      RandomAccessV2SD<> sd(cfg);
+      uint64_t sdMemSize = sd.memSize();
+      cerr << "sdv2 mem size: " << sdMemSize << endl;
+      cerr << "total mem size: " << cfgMemSize + sdMemSize << endl;
+      double time = benchmark(sd, cfg, eng, querySize, numQueries);
+      cerr << "average SD query time: " << time << "[µs]" << endl;
+    } else if (index == "ey") {
+      RandomAccessV2SD<StartIndexEytzinger<>> ey(cfg);
+      uint64_t eyMemSize = ey.memSize();
+      cerr << "eyv2 mem size: " << eyMemSize << endl;
+      cerr << "total mem size: " << cfgMemSize + eyMemSize << endl;
+      double time = benchmark(ey, cfg, eng, querySize, numQueries);
+      cerr << "average EY query time: " << time << "[µs]" << endl;
+    } else if (index == "pgm") {
+      RandomAccessV2SD<StartIndexPGM<>> pgm(cfg);
+      uint64_t pgmMemSize = pgm.memSize();
+      cerr << "pgmv2 mem size: " << pgmMemSize << endl;
+      cerr << "total mem size: " << cfgMemSize + pgmMemSize << endl;
+      double time = benchmark(pgm, cfg, eng, querySize, numQueries);
+      cerr << "average PGM query time: " << time << "[µs]" << endl;
+    } else if (index == "il") {
+      RandomAccessV2IL il(cfg);
+      uint64_t ilMemSize = il.memSize();
+      cerr << "ilv2 mem size: " << ilMemSize << endl;
+      // the records replace the grammar's rules
+      cerr << "total mem size: " << ilMemSize << endl;
+      double time = benchmark(il, cfg, eng, querySize, numQueries);
+      cerr << "average IL query time: " << time << "[µs]" << endl;
+    } else if (index == "packed") {
+      RandomAccessV2Coded<RulesPacked> packed(cfg);
+      uint64_t packedMemSize = packed.memSize();
+      cerr << "packed rules mem size: " << packed.rulesMemSize() << endl;
+      cerr << "packedv2 mem size: " << packedMemSize << endl;
+      // the encoded rules replace the grammar's rules
+      cerr << "total mem size: " << packedMemSize << endl;
+      double time = benchmark(packed, cfg, eng, querySize, numQueries);
+      cerr << "average PACKED query time: " << time << "[µs]" << endl;
+    } else if (index == "vbyte") {
+      RandomAccessV2Coded<RulesVByte> vbyte(cfg);
+      uint64_t vbyteMemSize = vbyte.memSize();
+      cerr << "vbyte rules mem size: " << vbyte.rulesMemSize() << endl;
+      cerr << "vbytev2 mem size: " << vbyteMemSize << endl;
+      // the encoded rules replace the grammar's rules
+      cerr << "total mem size: " << vbyteMemSize << endl;
+      double time = benchmark(vbyte, cfg, eng, querySize, numQueries);
+      cerr << "average VBYTE query time: " << time << "[µs]" << endl;
+    } else if (index == "cache") {
+      RandomAccessV2Cache<> cache(cfg, querySize);
+      uint64_t cacheMemSize = cache.memSize();
+      cerr << "cache k: " << querySize << endl;
+      cerr << "cache mem size: " << cache.cacheMemSize() << endl;
+      cerr << "cachev2 mem size: " << cacheMemSize << endl;
+      cerr << "total mem size: " << cfgMemSize + cacheMemSize << endl;
+      double time = benchmark(cache, cfg, eng, querySize, numQueries);
+      cerr << "average CACHE query time: " << time << "[µs]" << endl;
+    } else if (index == "amt") {
+      // the first run builds and saves the trie, later runs map it
+      chrono::steady_clock::time_point startTime = chrono::steady_clock::now();
+      RandomAccessAMT amt(cfg, filename + ".amt");
+      chrono::steady_clock::time_point endTime = chrono::steady_clock::now();
+      cerr << "amt startup time: " << chrono::duration_cast<chrono::microseconds>(endTime - startTime).count() << "[µs]" << endl;
+      uint64_t amtMemSize = amt.memSize();
+      cerr << "amt mem size: " << amtMemSize << endl;
+      cerr << "total mem size: " << cfgMemSize + amtMemSize << endl;
+      BufferedIndex<RandomAccessAMT> bufferedAMT(amt);
+      double time = benchmark(bufferedAMT, cfg, eng, querySize, numQueries);
+      cerr << "average AMT query time: " << time << "[µs]" << endl;
+    } else if (index == "start") {
+      bench::startIndex(cfg, eng, numQueries);
+    } else if (index == "startsweep") {
+      bench::startIndexSweep(cfg, eng, numQueries);
+    } else if (index == "pattern") {
+      bench::patternMatching(cfg, eng, querySize, numQueries);
+    } else if (index == "kr") {
+      bench::fingerprints(cfg, eng, querySize, numQueries);
+    } else if (index == "counts") {
+      bench::rangeCounts(cfg, eng, querySize, numQueries);
+    } else if (index == "lines") {
+      bench::lines(cfg, eng, numQueries);
+    } else if (index == "grep") {
+      bench::grep(cfg, eng, querySize, numQueries);
+    } else if (index == "extract") {
+      bench::extract(cfg);
+    } else if (index == "sinks") {
+      bench::sinks(cfg);
+    } else if (index == "amtinsert") {
+      bench::amtInsert(eng, numQueries);
+    } else if (index == "amtpredecessor") {
+      bench::amtPredecessor(eng, numQueries);
+    } else if (index == "amtrange") {
+      bench::amtRange(eng, numQueries);
+    } else {
+      cerr << "invalid index: \"" << index << "\"" << endl;
+      cerr << endl;
+      usage(argc, argv);
+    }
 
-    cerr << "total mem size: " << cfgMemSize + sdMemSize << endl;
-    
     // generate the original text
     //cfg->get(cout, 0, cfg->getTextLength() - 1);
 
-    // benchmarks
-    chrono::steady_clock::time_point startTime, endTime;
-    //uint64_t durationAMT = 0;
-    //uint64_t durationBV = 0;
-    //uint64_t durationBV2 = 0;
-    //uint64_t durationSD = 0;
-    uint32_t numLoops = 11;
-
-    uint64_t begin, end;
-    char* out = new char[querySize];
-    std::vector<double> times(numLoops);
-
-    //cout.setstate(std::ios::failbit);
-    for (int i = 0; i < numLoops; i++) {
-      double durationSD = 0;
-      for (int j = 0; j < numQueries; j++) {
-          //begin = distr(gen);
-          begin = (cfg->getTextLength() - querySize) * dist(eng);
-          //std::cerr << begin << std::endl;
-          end = begin + querySize - 1;
-
-          // AMT
-          //startTime = chrono::steady_clock::now();
-          //amt.get(cout, begin, end);
-          //endTime = chrono::steady_clock::now();
-          //durationAMT += chrono::duration_cast<chrono::microseconds>(endTime - startTime).count();
-
-          // BV
-          //startTime = chrono::steady_clock::now();
-          //bv.get(cout, begin, end);
-          //endTime = chrono::steady_clock::now();
-          //durationBV += chrono::duration_cast<chrono::microseconds>(endTime - startTime).count();
-
-          //begin = distr(gen);
-          //end = begin + querySize - 1;
-
-          // BV2
-          //startTime = chrono::steady_clock::now();
-          //bv2.get(cout, begin, end);
-          //endTime = chrono::steady_clock::now();
-          //durationBV2 += chrono::duration_cast<chrono::microseconds>(endTime - startTime).count();
-
-          // SD
-          startTime = chrono::steady_clock::now();
-          //sd.get(cout, begin, end);
-          sd.get(out, begin, end);
-          endTime = chrono::steady_clock::now();
-          durationSD += chrono::duration_cast<chrono::microseconds>(endTime - startTime).count();
-
-          //begin = distr(gen);
-          //end = begin + querySize - 1;
-      }
-
-      times[i] = durationSD / numQueries;
-    }
-    std::sort(times.begin(), times.end());
-
-    //cerr << "average AMT query time: " << durationAMT / numQueries << "[µs]" << endl;
-
-    //cerr << "average BV query time: " << durationBV / numQueries << "[µs]" << endl;
-
-    //cerr << "average BV2 query time: " << durationBV2 / numQueries << "[µs]" << endl;
-
-    cerr << "average SD query time: " << times[numLoops / 2] << "[µs]" << endl;
-
-    delete[] out;
     delete cfg;
 
     return 1;